@@ -0,0 +1,203 @@
+// Benchmark: per-level frontier exchange of the BFS generator
+// - gather: the original scheme, every rank sends its next frontier to rank 0 which merges it into a std::set, shuffles
+//   and broadcasts it, then the same again for the (child, parent) pairs. local_neighbours is cleared every level here,
+//   so only the exchange pattern is compared and not the quadratic growth of the original map
+// - allgatherv: generateTreeUsingBFS (src/generator/bfs.cpp), one MPI_Allgatherv per level, deduped by the visited bitmap
+// Both build a spanning tree of a size x size graph, the exchange time is the slowest rank's
+// Then generateTreeUsingBFS top-down only vs direction optimizing: levels run bottom-up, the levels where the direction
+// switched and the edge checks (all ranks), in total and in the bottom-up levels against what top-down needed there
+// Usage: mpirun -np N ./bfs_exchange_bench.out [size ...] (default 256 1024)
+#include <mpi.h>
+#include <algorithm>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "defs.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
+#include "bfs.hpp"
+
+#define BENCH_SEED 42
+
+struct Pair {
+    node_t first;
+    node_t second;
+    bool operator<(const Pair& other) const { return first < other.first || (first == other.first && second < other.second); }
+};
+
+// Receive a vector from every other rank on rank 0 (size first), or send ours
+template <class T>
+static void gather_to_root(std::vector<T>& local, MPI_Datatype type, int rank, int commSize, MPI_Comm comm, std::vector<std::vector<T>>& received) {
+    if (rank == 0) {
+        received.resize(commSize);
+        for (int i = 1; i < commSize; i++) {
+            int size;
+            MPI_Recv(&size, 1, MPI_INT, i, 0, comm, MPI_STATUS_IGNORE);
+            received[i].resize(size);
+            MPI_Recv(received[i].data(), size, type, i, 0, comm, MPI_STATUS_IGNORE);
+        }
+    } else {
+        int size = local.size();
+        MPI_Send(&size, 1, MPI_INT, 0, 0, comm);
+        MPI_Send(local.data(), size, type, 0, 0, comm);
+    }
+}
+
+template <class T>
+static void bcast_vector(std::vector<T>& v, MPI_Datatype type, int rank, MPI_Comm comm) {
+    int size = v.size();
+    MPI_Bcast(&size, 1, MPI_INT, 0, comm);
+    if (rank != 0) v.resize(size);
+    MPI_Bcast(v.data(), size, type, 0, comm);
+}
+
+// The original generateTreeUsingBFS exchange, with the frontier split fixed so every node is expanded once
+static void gather_bfs(const DynamicGrid& grid, BitplaneCells& maze, MPI_Comm comm, BFSStats* stats) {
+    int rank, commSize;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &commSize);
+
+    MPI_Datatype MPI_PAIR;
+    MPI_Type_contiguous(2, MPI_NODE_T, &MPI_PAIR);
+    MPI_Type_commit(&MPI_PAIR);
+
+    std::mt19937 gen(42);
+    std::vector<node_t> global_frontier = {grid.node(grid.height() / 2, grid.width() / 2)};
+    std::vector<node_t> next_local_frontier;
+    std::unordered_map<node_t, node_t> local_neighbours;
+    std::vector<std::vector<node_t>> frontiers;
+    std::vector<std::vector<Pair>> pairs;
+    while (!global_frontier.empty()) {
+        for (node_t node : global_frontier) maze.set_visited(node);
+        next_local_frontier.clear();
+        local_neighbours.clear();
+        node_t first = rank * (global_frontier.size() / commSize) + std::min<node_t>(rank, global_frontier.size() % commSize);
+        node_t last = (rank + 1) * (global_frontier.size() / commSize) + std::min<node_t>(rank + 1, global_frontier.size() % commSize);
+        for (node_t i = first; i < last; i++) {
+            node_t node = global_frontier[i];
+            grid.for_each_neighbour(node, [&](node_t neighbour, int dir) {
+                if (!maze.is_visited(neighbour)) {
+                    next_local_frontier.push_back(neighbour);
+                    local_neighbours[neighbour] = node;
+                    maze.set_visited(neighbour);
+                }
+                return false;
+            });
+        }
+
+        double t0 = MPI_Wtime();
+        gather_to_root(next_local_frontier, MPI_NODE_T, rank, commSize, comm, frontiers);
+        global_frontier.clear();
+        if (rank == 0) {
+            std::set<node_t> merged(next_local_frontier.begin(), next_local_frontier.end());
+            for (int i = 1; i < commSize; i++) merged.insert(frontiers[i].begin(), frontiers[i].end());
+            global_frontier.assign(merged.begin(), merged.end());
+            std::shuffle(global_frontier.begin(), global_frontier.end(), gen);
+        }
+        bcast_vector(global_frontier, MPI_NODE_T, rank, comm);
+
+        std::vector<Pair> local_pairs, global_pairs;
+        for (auto& p : local_neighbours) local_pairs.push_back(Pair{p.first, p.second});
+        gather_to_root(local_pairs, MPI_PAIR, rank, commSize, comm, pairs);
+        if (rank == 0) {
+            std::set<Pair> merged;
+            std::set<node_t> seen;
+            pairs[0] = local_pairs;
+            for (int i = 0; i < commSize; i++)
+                for (const Pair& p : pairs[i])
+                    if (seen.insert(p.first).second) merged.insert(p);
+            global_pairs.assign(merged.begin(), merged.end());
+        }
+        bcast_vector(global_pairs, MPI_PAIR, rank, comm);
+        stats->exchange_s += MPI_Wtime() - t0;
+        stats->levels++;
+
+        for (const Pair& p : global_pairs) {
+            grid.for_each_neighbour(p.second, [&](node_t neighbour, int dir) {
+                if (neighbour != p.first) return false;
+                maze.connect(p.second, p.first, dir);
+                return true;
+            });
+        }
+    }
+    MPI_Type_free(&MPI_PAIR);
+}
+
+// Run one exchange scheme and print levels, total / per level exchange time (slowest rank) and the total runtime
+template <class F>
+static void measure(const char* scheme, node_t size, F run, MPI_Comm comm) {
+    int rank, commSize;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &commSize);
+    DynamicGrid grid(size, size);
+    BitplaneCells maze(grid.cells(), GRAPH_PLANES);
+    BFSStats stats;
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+    run(grid, maze, &stats);
+    double total = MPI_Wtime() - t0;
+    double exchange_s, total_s;
+    MPI_Reduce(&stats.exchange_s, &exchange_s, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+    MPI_Reduce(&total, &total_s, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (rank == 0) {
+        printf("%-10s %5d %6lld %7d %11.3f %14.1f %9.3f\n", scheme, commSize, (long long)size, stats.levels, exchange_s, exchange_s / stats.levels * 1e6, total_s);
+        fflush(stdout);
+    }
+}
+
+// Run generateTreeUsingBFS and print its direction / edge check counters summed over the ranks
+static void measure_direction(const char* scheme, node_t size, bool direction_optimizing, MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    DynamicGrid grid(size, size);
+    BitplaneCells maze(grid.cells(), GRAPH_PLANES);
+    BFSStats stats;
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+    generateTreeUsingBFS(grid, maze, comm, BENCH_SEED, &stats, direction_optimizing);
+    double total = MPI_Wtime() - t0, total_s;
+    long long local[3] = {stats.edge_checks, stats.bottom_up_checks, stats.top_down_checks}, global[3];
+    MPI_Reduce(local, global, 3, MPI_LONG_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce(&total, &total_s, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (rank == 0) {
+        printf("%-10s %6lld %7d %9d %13lld %13lld %13lld %9.3f  switches at", scheme, (long long)size, stats.levels, stats.bottom_up_levels, global[0], global[1], global[2], total_s);
+        for (int level : stats.switch_levels) printf(" %d", level);
+        printf("\n");
+        fflush(stdout);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    std::vector<node_t> sizes;
+    for (int i = 1; i < argc; i++) sizes.push_back(atoll(argv[i]));
+    if (sizes.empty()) sizes = {256, 1024};
+
+    if (rank == 0)
+        printf("%-10s %5s %6s %7s %11s %14s %9s\n", "scheme", "ranks", "size", "levels", "exchange_s", "us/level", "total_s");
+    for (node_t size : sizes) {
+        measure("gather", size, [&](const DynamicGrid& grid, BitplaneCells& maze, BFSStats* stats) {
+            gather_bfs(grid, maze, MPI_COMM_WORLD, stats);
+        }, MPI_COMM_WORLD);
+        measure("allgatherv", size, [&](const DynamicGrid& grid, BitplaneCells& maze, BFSStats* stats) {
+            generateTreeUsingBFS(grid, maze, MPI_COMM_WORLD, BENCH_SEED, stats, false);
+        }, MPI_COMM_WORLD);
+    }
+
+    if (rank == 0)
+        printf("\n%-10s %6s %7s %9s %13s %13s %13s %9s\n", "direction", "size", "levels", "bottom_up", "edge_checks", "bu_checks", "td_would_be", "total_s");
+    for (node_t size : sizes) {
+        measure_direction("top-down", size, false, MPI_COMM_WORLD);
+        measure_direction("optimizing", size, true, MPI_COMM_WORLD);
+    }
+
+    MPI_Finalize();
+    return 0;
+}
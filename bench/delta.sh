@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+# Runtime of the delta-stepping solver (-s dijkstra) against its bucket width, on one weighted maze
+# (the generator keeps the node weights in the maze, so the maze is regenerated with the same seed for every delta)
+# Usage: bench/delta.sh [size] [generator]
+#   NP      - number of ranks (default 4)
+#   DELTAS  - bucket widths to try (default 1 2 4 ... 1024)
+#   MPIRUN  - launcher command (default "mpirun")
+set -euo pipefail
+
+SIZE=${1:-4096}
+GEN=${2:-boruvka}
+NP=${NP:-4}
+DELTAS=${DELTAS:-"1 2 4 8 16 32 64 128 256 512 1024"}
+MPIRUN=${MPIRUN:-mpirun}
+BIN=${BIN:-./maze.out}
+
+printf "%-8s %-12s %-16s\n" "delta" "solve_s" "peak_rss_mb/rank"
+for delta in $DELTAS; do
+    stats=$($MPIRUN -np "$NP" "$BIN" -g "$GEN" -s dijkstra --delta "$delta" -n "$SIZE" --seed 1 -q --stats 2>&1 >/dev/null)
+    solve=$(echo "$stats" | awk '/^solve_s/ {m=0; for (i=2;i<=NF;i++) if ($i>m) m=$i; print m}')
+    rss=$(echo "$stats" | awk '/^peak_rss_mb/ {$1=""; print substr($0,2)}')
+    printf "%-8s %-12s %-16s\n" "$delta" "$solve" "$rss"
+done
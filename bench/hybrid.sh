@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+# Strong scaling of the BFS generator: pure MPI (a rank per core) vs hybrid MPI + OpenMP (fewer ranks, -t threads each)
+# on the same number of cores, for one maze size
+# Usage: bench/hybrid.sh [size]
+#   CORES   - cores to use (default nproc)
+#   MPIRUN  - launcher command (default "mpirun --bind-to none", so the threads of a rank are not pinned to one core)
+set -euo pipefail
+
+SIZE=${1:-8192}
+CORES=${CORES:-$(nproc)}
+MPIRUN=${MPIRUN:-mpirun --bind-to none}
+BIN=${BIN:-./maze.out}
+
+printf "%-6s %-8s %-12s %-16s\n" "ranks" "threads" "generate_s" "peak_rss_mb/rank"
+threads=1
+while [ "$threads" -le "$CORES" ]; do
+    ranks=$((CORES / threads))
+    stats=$($MPIRUN -np "$ranks" "$BIN" -g bfs -o /dev/null -n "$SIZE" -r bitplane -t "$threads" -q --stats 2>&1 >/dev/null)
+    gen=$(echo "$stats" | awk '/^generate_s/ {m=0; for (i=2;i<=NF;i++) if ($i>m) m=$i; print m}')
+    rss=$(echo "$stats" | awk '/^peak_rss_mb/ {$1=""; print substr($0,2)}' | cut -c1-60)
+    printf "%-6s %-8s %-12s %-16s\n" "$ranks" "$threads" "$gen" "$rss"
+    threads=$((threads * 2))
+done
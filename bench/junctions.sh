@@ -0,0 +1,51 @@
+#!/usr/bin/env bash
+# Corridor contraction (-s junction) against the cell solvers on the same mazes
+# - solve: one rank solving the maze's own entry / exit with -s astar, -s dijkstra and -s junction. visited is the
+#   expanded nodes (closed cells for astar, settled cells for dijkstra, closed junctions for junction) and the
+#   solve time of junction includes building its graph
+# - queries: QUERIES random pairs of tree cells (even rows / odd columns) answered with --queries by -s bfs (one BFS
+#   per start) and by -s junction (one graph build, then one A* per query), prepare_s is the graph build
+# Usage: bench/junctions.sh [size] [queries]
+#   GENS    - generators of the solve mazes (default "boruvka eller", boruvka / kruskal are weighted)
+#   QGEN    - generator of the queries maze (default eller)
+#   NP      - ranks of the queries runs (default 1)
+#   THREADS - OpenMP threads per rank (default 1)
+#   MPIRUN  - launcher command (default "mpirun")
+set -euo pipefail
+
+SIZE=${1:-4096}
+QUERIES=${2:-100}
+GENS=${GENS:-"boruvka eller"}
+QGEN=${QGEN:-eller}
+NP=${NP:-1}
+THREADS=${THREADS:-1}
+MPIRUN=${MPIRUN:-mpirun}
+BIN=${BIN:-./maze.out}
+
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+max() { awk -v key="$1" '$1 == key {m=0; for (i=2;i<=NF;i++) if ($i>m) m=$i; print m}'; }
+
+printf "%-10s %-10s %-10s %-12s %-10s\n" "generator" "solver" "solve_s" "visited" "reduction"
+for gen in $GENS; do
+    base=""
+    for solver in astar dijkstra junction; do
+        stats=$($MPIRUN -np 1 "$BIN" -g "$gen" -n "$SIZE" --seed 1 -s "$solver" -t "$THREADS" -q --stats 2>&1 >/dev/null)
+        solve=$(echo "$stats" | max solve_s)
+        visited=$(echo "$stats" | max solve_visited)
+        [ -z "$base" ] && base=$visited
+        printf "%-10s %-10s %-10s %-12.0f %-10.2f\n" "$gen" "$solver" "$solve" "$visited" "$(awk -v a="$base" -v b="$visited" 'BEGIN { print (b > 0 ? a / b : 0) }')"
+    done
+done
+
+echo
+$MPIRUN -np 1 "$BIN" -g "$QGEN" -n "$SIZE" --seed 1 -o "$DIR/maze" -q
+awk -v n="$QUERIES" -v half=$((SIZE / 2)) 'BEGIN { srand(1); for (i = 0; i < n; i++)
+    printf "%d %d %d %d\n", 2 * int(rand() * half), 2 * int(rand() * half) + 1, 2 * int(rand() * half), 2 * int(rand() * half) + 1 }' > "$DIR/queries"
+printf "%-10s %-10s %-12s %-12s %-14s\n" "solver" "queries" "prepare_s" "query_s" "queries_per_s"
+for solver in bfs junction; do
+    stats=$($MPIRUN -np "$NP" "$BIN" -i "$DIR/maze" -s "$solver" -t "$THREADS" --queries "$DIR/queries" --answers "$DIR/$solver" --answer-format bin --stats 2>&1 >/dev/null)
+    qps=$(echo "$stats" | awk '/^queries / {print $4}')
+    printf "%-10s %-10s %-12s %-12s %-14s\n" "$solver" "$QUERIES" "$(echo "$stats" | max prepare_s)" "$(echo "$stats" | max query_s)" "$qps"
+done
+cmp -s "$DIR/bfs" "$DIR/junction" || echo "warning: bfs and junction answers differ" >&2
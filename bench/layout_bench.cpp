@@ -0,0 +1,172 @@
+// Benchmark: row-major (Pow2Grid / Grid<>) vs tiled (TiledGrid) cell layout
+// Runs the two access patterns that suffer from vertical steps on wide grids, over the whole grid:
+// - bfs: level synchronous frontier expansion marking visited cells and tree links (generateTreeUsingBFS)
+// - dfs: depth first walk keeping the parent direction in the cells and backtracking through it (solveUsingDFS)
+// and reports the runtime along with cache misses from the hardware counters (perf_event_open) when available
+// Usage: ./layout_bench.out [size ...] (default 4096 16384)
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "defs.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
+
+// One hardware counter for the calling thread (user space only, so it works with perf_event_paranoid <= 2)
+class PerfCounter {
+public:
+    PerfCounter(unsigned type, unsigned long long config) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~PerfCounter() { if (fd >= 0) close(fd); }
+
+    bool available() const { return fd >= 0; }
+    void start() {
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    long long stop() {
+        if (fd < 0) return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        long long count;
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) return -1;
+        return count;
+    }
+
+private:
+    int fd;
+};
+
+#define L1D_READ_MISS (PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static PerfCounter* llc_misses;
+static PerfCounter* l1d_misses;
+
+static void print_count(long long count, node_t cells) {
+    if (count < 0) printf(" %14s %8s", "n/a", "");
+    else printf(" %14lld %8.3f", count, (double)count / cells);
+}
+
+// Time f() and print one row: runtime, then LLC and L1D misses (total and per cell)
+template <class F>
+static void measure(const char* kernel, const char* layout, const char* cells_name, node_t size, node_t cells, F f) {
+    llc_misses->start();
+    l1d_misses->start();
+    auto start = std::chrono::steady_clock::now();
+    node_t checksum = f();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long long llc = llc_misses->stop();
+    long long l1d = l1d_misses->stop();
+    printf("%-4s %6lld %-6s %-9s %9.3f", kernel, (long long)size, layout, cells_name, seconds);
+    print_count(llc, cells);
+    print_count(l1d, cells);
+    printf("   (checksum %lld)\n", (long long)checksum);
+    fflush(stdout);
+}
+
+// Frontier expansion from the centre, every cell gets linked to the cell that discovered it
+template <class GridT, class Cells>
+static node_t bfs_kernel(const GridT& grid) {
+    Cells cells(grid.cells(), GRAPH_PLANES);
+    std::vector<node_t> frontier, next;
+    node_t start = grid.node(grid.height() / 2, grid.width() / 2);
+    cells.set_visited(start);
+    frontier.push_back(start);
+    node_t visited = 1;
+    while (!frontier.empty()) {
+        next.clear();
+        for (node_t node : frontier) {
+            grid.for_each_neighbour(node, [&](node_t neighbour, int dir) {
+                if (!cells.is_visited(neighbour)) {
+                    cells.set_visited(neighbour);
+                    cells.connect(node, neighbour, dir);
+                    next.push_back(neighbour);
+                    visited++;
+                }
+                return false;
+            });
+        }
+        frontier.swap(next);
+    }
+    return visited;
+}
+
+// Depth first walk from the top right corner (the maze entry), without a stack: the parent direction is kept in the
+// cells like the solvers do, and dead ends backtrack through it
+template <class GridT, class Cells>
+static node_t dfs_kernel(const GridT& grid) {
+    Cells cells(grid.cells(), PLANE_VISITED_SOLVE | PLANE_PARENT);
+    node_t start = grid.node(0, grid.width() - 1);
+    node_t node = start;
+    cells.set_visited_solve(node);
+    node_t steps = 0;
+    while (true) {
+        node_t next = -1;
+        grid.for_each_neighbour(node, [&](node_t neighbour, int dir) {
+            if (cells.is_visited_solve(neighbour)) return false;
+            cells.set_visited_solve(neighbour);
+            cells.set_parent_dir(neighbour, OPPOSITE_DIR(dir));
+            next = neighbour;
+            return true;
+        });
+        steps++;
+        if (next != -1) {
+            node = next;
+        } else if (node == start) {
+            break;
+        } else {
+            node = grid.step(node, cells.parent_dir(node));
+        }
+    }
+    return steps;
+}
+
+template <class GridT, class Cells>
+static void bench_layout(const char* layout, const char* cells_name, node_t size) {
+    GridT grid(size, size);
+    measure("bfs", layout, cells_name, size, size * size, [&]() { return bfs_kernel<GridT, Cells>(grid); });
+    measure("dfs", layout, cells_name, size, size * size, [&]() { return dfs_kernel<GridT, Cells>(grid); });
+}
+
+template <class Cells>
+static void bench_size(const char* cells_name, node_t size) {
+    if (is_pow2(size)) bench_layout<Pow2Grid, Cells>("rows", cells_name, size);
+    else bench_layout<DynamicGrid, Cells>("rows", cells_name, size);
+    bench_layout<TiledGrid, Cells>("tiled", cells_name, size);
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<node_t> sizes;
+    for (int i = 1; i < argc; i++) sizes.push_back(atoll(argv[i]));
+    if (sizes.empty()) sizes = {4096, 16384};
+
+    llc_misses = new PerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    l1d_misses = new PerfCounter(PERF_TYPE_HW_CACHE, L1D_READ_MISS);
+    if (!llc_misses->available() || !l1d_misses->available())
+        fprintf(stderr, "warning: hardware cache counters unavailable (perf_event_open failed), only timing the runs\n");
+
+    printf("%-4s %6s %-6s %-9s %9s %14s %8s %14s %8s\n", "alg", "size", "layout", "cells", "seconds", "llc_misses", "/cell", "l1d_misses", "/cell");
+    for (node_t size : sizes) {
+        bench_size<PackedCells>("packed", size);
+        bench_size<BitplaneCells>("bitplane", size);
+    }
+
+    delete llc_misses;
+    delete l1d_misses;
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Microbenchmark: neighbour expansion throughput of the defs.hpp macros vs the grid.hpp topologies
+// Every pass expands all nodes (in row order, and in a shuffled order like a BFS frontier) and sums up the ids
+// of their neighbours so the work can't be optimized away
+// Usage: ./neighbour_bench.out [passes]
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "defs.hpp"
+#include "grid.hpp"
+
+#define BENCH_DIM 2048
+#define BENCH_DIM_NON_POW2 2000
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, const char* order, node_t nodes, int passes, double seconds, node_t checksum) {
+    printf("%-30s %-9s %8.1f Mnodes/s  (checksum %lld)\n", name, order, (double)nodes * passes / seconds / 1e6, (long long)checksum);
+}
+
+// The 4 macros, as the generators / solvers used to call them
+static void bench_macros(const std::vector<node_t>& order, const char* order_name, int width, int height, int passes) {
+    node_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+        for (node_t node : order) {
+            node_t neighbour;
+            if ((neighbour = LEFT_NODE(node, width)) != -1) sum += neighbour;
+            if ((neighbour = RIGHT_NODE(node, width)) != -1) sum += neighbour;
+            if ((neighbour = UP_NODE(node, width)) != -1) sum += neighbour;
+            if ((neighbour = DOWN_NODE(node, width, height)) != -1) sum += neighbour;
+        }
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "macros %dx%d", width, height);
+    report(name, order_name, order.size(), passes, seconds_since(start), sum);
+}
+
+// grid.for_each_neighbour: coordinates computed once per node
+template <class GridT>
+static void bench_grid(const std::vector<node_t>& order, const char* order_name, const char* label, const GridT& grid, int passes) {
+    node_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+        for (node_t node : order) {
+            grid.for_each_neighbour(node, [&](node_t neighbour, int dir) {
+                sum += neighbour;
+                return false;
+            });
+        }
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "%s %lldx%lld", label, (long long)grid.width(), (long long)grid.height());
+    report(name, order_name, order.size(), passes, seconds_since(start), sum);
+}
+
+// grid.for_each_edge: row walk, no coordinates computed (each edge is seen once, so counted from both ends)
+template <class GridT>
+static void bench_edge_walk(const char* label, const GridT& grid, int passes) {
+    node_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+        grid.for_each_edge([&](node_t node, node_t neighbour, int dir) {
+            sum += node + neighbour;
+        });
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "%s %lldx%lld", label, (long long)grid.width(), (long long)grid.height());
+    report(name, "rows", grid.cells(), passes, seconds_since(start), sum);
+}
+
+template <class GridT>
+static void bench_all(const char* label, const GridT& grid, int passes) {
+    std::vector<node_t> rows(grid.cells());
+    for (node_t i = 0; i < grid.cells(); i++) rows[i] = i;
+    std::vector<node_t> shuffled = rows;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(42));
+
+    bench_macros(rows, "rows", grid.width(), grid.height(), passes);
+    bench_grid(rows, "rows", label, grid, passes);
+    bench_macros(shuffled, "shuffled", grid.width(), grid.height(), passes);
+    bench_grid(shuffled, "shuffled", label, grid, passes);
+    bench_edge_walk(label, grid, passes);
+}
+
+int main(int argc, char* argv[]) {
+    int passes = argc > 1 ? atoi(argv[1]) : 10;
+
+    bench_all("Grid<W,H>", Grid<BENCH_DIM, BENCH_DIM>(BENCH_DIM, BENCH_DIM), passes);
+    bench_all("Pow2Grid", Pow2Grid(BENCH_DIM, BENCH_DIM), passes);
+    bench_all("Grid<>", DynamicGrid(BENCH_DIM, BENCH_DIM), passes);
+    bench_all("Grid<>", DynamicGrid(BENCH_DIM_NON_POW2, BENCH_DIM_NON_POW2), passes);
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Benchmark: maze output, the old per-cell printf path vs the buffered lookup table writer (mazeprint.hpp)
+// The mazes are written to stdout (run it with stdout redirected, e.g. to /dev/null), timings go to stderr
+// Usage: ./print_bench.out [size ...] > /dev/null (default 4096 16384)
+#include <chrono>
+#include <random>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "defs.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
+#include "mazeprint.hpp"
+
+// print_maze_final as it was before mazeprint.hpp: one printf per cell
+template <class GridT, class Cells>
+static void print_maze_printf(const GridT& grid, Cells& edges, node_t start, node_t end) {
+    for (int i = 0; i < grid.height(); i++) {
+        for (int j = 0; j < grid.width(); j++) {
+            node_t node = grid.node(i, j);
+            if (!edges.is_c(node)) {
+                printf("*");
+            } else if (node == start) {
+                printf("S");
+            } else if (node == end) {
+                printf("E");
+            } else if (edges.is_p(node)) {
+                printf("P");
+            } else if (edges.is_c(node)) {
+                printf(" ");
+            } else {
+                printf("?");
+            }
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+template <class F>
+static void measure(const char* name, const char* cells_name, node_t size, F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%-7s %-9s %6lld %9.3f s %9.1f Mcells/s\n", name, cells_name, (long long)size, seconds, (double)size * size / seconds / 1e6);
+}
+
+template <class Cells>
+static void bench_size(const char* cells_name, node_t size) {
+    Pow2Grid grid(size, size);
+    Cells maze(grid.cells(), MAZE_PLANES);
+    // About half open cells and a few path cells, at random so the old branch chain can't be predicted
+    std::mt19937_64 gen(42);
+    for (node_t node = 0; node < grid.cells(); node++) {
+        uint64_t r = gen();
+        if (r & 1) maze.set_c(node);
+        if ((r & 0x70) == 0 && (r & 1)) maze.set_p(node);
+    }
+    node_t start = grid.node(0, size - 1);
+    node_t end = grid.node(size - 1, 0);
+    maze.set_c(start);
+    maze.set_c(end);
+
+    measure("printf", cells_name, size, [&]() { print_maze_printf(grid, maze, start, end); });
+    measure("ascii", cells_name, size, [&]() { write_maze(stdout, grid, maze, start, end, OUTPUT_ASCII); });
+    measure("pbm", cells_name, size, [&]() { write_maze(stdout, grid, maze, start, end, OUTPUT_PBM); });
+    measure("pgm", cells_name, size, [&]() { write_maze(stdout, grid, maze, start, end, OUTPUT_PGM); });
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<node_t> sizes;
+    for (int i = 1; i < argc; i++) sizes.push_back(atoll(argv[i]));
+    if (sizes.empty()) sizes = {4096, 16384};
+
+    for (node_t size : sizes) {
+        bench_size<PackedCells>("packed", size);
+        bench_size<BitplaneCells>("bitplane", size);
+    }
+    return 0;
+}
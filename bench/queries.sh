@@ -0,0 +1,54 @@
+#!/usr/bin/env bash
+# Throughput of batch queries (--queries) against one mpirun launch per start / end pair, on the same maze file
+# - random: QUERIES pairs of random cells, answered with the tree path index (-s lca)
+# - grouped: the same number of pairs but only STARTS distinct starts, answered with -s lca and with -s bfs (one BFS
+#   per start), as when many destinations are asked from a few sources
+# - single: a launch that loads the maze and solves its one pair with -s dfs, timed over SINGLE launches
+# Queries use the cells at even rows / odd columns, which are the tree nodes and open in every generated maze
+# Usage: bench/queries.sh [size] [queries] [generator]
+#   NP      - number of ranks (default 4)
+#   THREADS - OpenMP threads per rank (default 1)
+#   STARTS  - distinct starts of the grouped queries (default 16)
+#   SINGLE  - single launches to time (default 10)
+#   MPIRUN  - launcher command (default "mpirun")
+set -euo pipefail
+
+SIZE=${1:-4096}
+QUERIES=${2:-1000000}
+GEN=${3:-eller}
+NP=${NP:-4}
+THREADS=${THREADS:-1}
+STARTS=${STARTS:-16}
+SINGLE=${SINGLE:-10}
+MPIRUN=${MPIRUN:-mpirun}
+BIN=${BIN:-./maze.out}
+
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+$MPIRUN -np 1 "$BIN" -g "$GEN" -n "$SIZE" --seed 1 -o "$DIR/maze" -q
+awk -v n="$QUERIES" -v half=$((SIZE / 2)) 'BEGIN { srand(1); for (i = 0; i < n; i++)
+    printf "%d %d %d %d\n", 2 * int(rand() * half), 2 * int(rand() * half) + 1, 2 * int(rand() * half), 2 * int(rand() * half) + 1 }' > "$DIR/random"
+awk -v n="$QUERIES" -v starts="$STARTS" -v half=$((SIZE / 2)) 'BEGIN { srand(2); for (s = 0; s < starts; s++) { r[s] = 2 * int(rand() * half); c[s] = 2 * int(rand() * half) + 1 }
+    for (i = 0; i < n; i++) printf "%d %d %d %d\n", r[i % starts], c[i % starts], 2 * int(rand() * half), 2 * int(rand() * half) + 1 }' > "$DIR/grouped"
+
+now() { date +%s.%N; }
+
+printf "%-14s %-10s %-12s %-12s %-14s %-14s\n" "run" "queries" "wall_s" "prepare_s" "query_s" "queries_per_s"
+for run in "random lca" "grouped lca" "grouped bfs"; do
+    set -- $run
+    t0=$(now)
+    stats=$($MPIRUN -np "$NP" "$BIN" -i "$DIR/maze" -s "$2" -t "$THREADS" --queries "$DIR/$1" --answers "$DIR/answers" --answer-format bin --stats 2>&1 >/dev/null)
+    t1=$(now)
+    prepare=$(echo "$stats" | awk '/^prepare_s/ {m=0; for (i=2;i<=NF;i++) if ($i>m) m=$i; print m}')
+    query=$(echo "$stats" | awk '/^query_s/ {m=0; for (i=2;i<=NF;i++) if ($i>m) m=$i; print m}')
+    qps=$(echo "$stats" | awk '/^queries / {print $4}')
+    printf "%-14s %-10s %-12.3f %-12s %-14s %-14s\n" "$1-$2" "$QUERIES" "$(awk -v a="$t0" -v b="$t1" 'BEGIN { print b - a }')" "$prepare" "$query" "$qps"
+done
+
+t0=$(now)
+for i in $(seq "$SINGLE"); do
+    $MPIRUN -np "$NP" "$BIN" -i "$DIR/maze" -s dfs -q
+done
+t1=$(now)
+wall=$(awk -v a="$t0" -v b="$t1" 'BEGIN { print b - a }')
+printf "%-14s %-10s %-12.3f %-12s %-14s %-14.2f\n" "single-dfs" "$SINGLE" "$wall" "-" "-" "$(awk -v n="$SINGLE" -v w="$wall" 'BEGIN { print n / w }')"
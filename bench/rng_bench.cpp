@@ -0,0 +1,59 @@
+// Benchmark: weight generation throughput of the graph nodes (init_graph in src/generator/mazegenerator.cpp)
+// - mt19937: the original scheme, one sequential std::mt19937 + uniform_int_distribution on rank 0 (the weights were
+//   then broadcast to the other ranks, which is not timed here)
+// - philox: for_each_weight (src/rng.hpp), every weight computed from (seed, node id), row by row like init_graph, on
+//   one thread and on all OpenMP threads (OMP_NUM_THREADS), which is what every rank now does instead of receiving
+//   the broadcast
+// Usage: ./rng_bench.out [size ...] (default 4096 16384, weights for a size x size graph)
+#include <chrono>
+#include <random>
+#include <vector>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "defs.hpp"
+#include "rng.hpp"
+
+#define BENCH_SEED 42
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* scheme, int threads, node_t size, double seconds, const std::vector<uint8_t>& weights) {
+    unsigned long long checksum = 0;
+    for (uint8_t w : weights) checksum += w;
+    printf("%-8s %7d %6lld %9.3f %10.1f   (checksum %llu)\n", scheme, threads, (long long)size, seconds, (double)weights.size() / seconds / 1e6, checksum);
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<node_t> sizes;
+    for (int i = 1; i < argc; i++) sizes.push_back(atoll(argv[i]));
+    if (sizes.empty()) sizes = {4096, 16384};
+
+    printf("%-8s %7s %6s %9s %10s\n", "scheme", "threads", "size", "seconds", "Mweights/s");
+    for (node_t size : sizes) {
+        std::vector<uint8_t> weights(size * size);
+
+        auto start = std::chrono::steady_clock::now();
+        std::mt19937 gen(BENCH_SEED);
+        std::uniform_int_distribution<> dis(1, 255);
+        for (node_t i = 0; i < size * size; i++) weights[i] = dis(gen);
+        report("mt19937", 1, size, seconds_since(start), weights);
+
+        int threads[2] = {1, omp_get_max_threads()};
+        for (int t = 0; t < (threads[1] > 1 ? 2 : 1); t++) {
+            start = std::chrono::steady_clock::now();
+            #pragma omp parallel for schedule(static) num_threads(threads[t])
+            for (node_t row = 0; row < size; row++) {
+                for_each_weight(BENCH_SEED, row * size, (row + 1) * size, [&](node_t index, int weight) {
+                    weights[index] = weight;
+                });
+            }
+            report("philox", threads[t], size, seconds_since(start), weights);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,25 @@
+#!/usr/bin/env bash
+# Scaling benchmark: generate + solve time and peak RSS per rank for growing square mazes
+# Usage: bench/scaling.sh [generator] [solver] [max_size]
+#   NP      - number of ranks (default 4)
+#   MPIRUN  - launcher command (default "mpirun")
+set -euo pipefail
+
+GEN=${1:-bfs}
+SOLVER=${2:-dfs}
+MAX_SIZE=${3:-16384}
+NP=${NP:-4}
+MPIRUN=${MPIRUN:-mpirun}
+BIN=${BIN:-./maze.out}
+
+printf "%-8s %-12s %-12s %-16s\n" "size" "generate_s" "solve_s" "peak_rss_mb/rank"
+size=64
+while [ "$size" -le "$MAX_SIZE" ]; do
+    stats=$($MPIRUN -np "$NP" "$BIN" -g "$GEN" -s "$SOLVER" -n "$size" -q --stats 2>&1 >/dev/null)
+    # Report the slowest rank for times and every rank for memory
+    gen=$(echo "$stats" | awk '/^generate_s/ {m=0; for (i=2;i<=NF;i++) if ($i>m) m=$i; print m}')
+    solve=$(echo "$stats" | awk '/^solve_s/ {m=0; for (i=2;i<=NF;i++) if ($i>m) m=$i; print m}')
+    rss=$(echo "$stats" | awk '/^peak_rss_mb/ {$1=""; print substr($0,2)}')
+    printf "%-8s %-12s %-12s %-16s\n" "$size" "$gen" "$solve" "$rss"
+    size=$((size * 2))
+done
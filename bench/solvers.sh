@@ -0,0 +1,24 @@
+#!/usr/bin/env bash
+# Solvers side by side on the same weighted maze: time and cells visited (the VISITED_SOLVE bits: pushed for dfs,
+# settled for dijkstra, closed for astar, summed over the ranks)
+# Usage: bench/solvers.sh [size] [generator]
+#   NP      - number of ranks (default 4)
+#   SOLVERS - solvers to compare (default "dfs dijkstra astar")
+#   MPIRUN  - launcher command (default "mpirun")
+set -euo pipefail
+
+SIZE=${1:-4096}
+GEN=${2:-boruvka}
+NP=${NP:-4}
+SOLVERS=${SOLVERS:-"dfs dijkstra astar"}
+MPIRUN=${MPIRUN:-mpirun}
+BIN=${BIN:-./maze.out}
+
+printf "%-10s %-12s %-14s %-16s\n" "solver" "solve_s" "visited" "peak_rss_mb/rank"
+for solver in $SOLVERS; do
+    stats=$($MPIRUN -np "$NP" "$BIN" -g "$GEN" -s "$solver" -n "$SIZE" --seed 1 -q --stats 2>&1 >/dev/null)
+    solve=$(echo "$stats" | awk '/^solve_s/ {m=0; for (i=2;i<=NF;i++) if ($i>m) m=$i; print m}')
+    visited=$(echo "$stats" | awk '/^solve_visited/ {s=0; for (i=2;i<=NF;i++) s+=$i; print s}')
+    rss=$(echo "$stats" | awk '/^peak_rss_mb/ {$1=""; print substr($0,2)}')
+    printf "%-10s %-12s %-14s %-16s\n" "$solver" "$solve" "$visited" "$rss"
+done
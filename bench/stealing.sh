@@ -0,0 +1,41 @@
+#!/usr/bin/env bash
+# Load balance of the DFS solvers on the same perfect mazes: the static split of the first BFS frontier (-s dfs)
+# against work stealing (-s wsdfs). Per run: the solve time, the cells visited (VISITED_SOLVE bits) over all ranks and
+# on the busiest rank, the imbalance (busiest / mean) and the speedup over -s dfs on one rank
+# Usage: bench/stealing.sh [size] [generator]
+#   RANKS   - rank counts to run (default "1 2 4 8")
+#   THREADS - OpenMP threads per rank of -s wsdfs (default 1)
+#   SEEDS   - mazes to run (default "1 2 3")
+#   MPIRUN  - launcher command (default "mpirun"), Open MPI in containers without CMA may need
+#             "mpirun --mca btl_vader_single_copy_mechanism none" for the one-sided steals
+set -euo pipefail
+
+SIZE=${1:-4096}
+GEN=${2:-eller}
+RANKS=${RANKS:-"1 2 4 8"}
+THREADS=${THREADS:-1}
+SEEDS=${SEEDS:-"1 2 3"}
+MPIRUN=${MPIRUN:-mpirun}
+BIN=${BIN:-./maze.out}
+
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+printf "%-6s %-7s %-6s %-8s %-10s %-12s %-12s %-10s %-8s\n" "seed" "solver" "ranks" "threads" "solve_s" "visited" "busiest" "imbalance" "speedup"
+for seed in $SEEDS; do
+    $MPIRUN -np 1 "$BIN" -g "$GEN" -n "$SIZE" --seed "$seed" -o "$DIR/maze" -q
+    base=""
+    for solver in dfs wsdfs; do
+        threads=1
+        [ "$solver" = wsdfs ] && threads=$THREADS
+        for np in $RANKS; do
+            stats=$($MPIRUN -np "$np" "$BIN" -i "$DIR/maze" -s "$solver" -t "$threads" -q --stats 2>&1 >/dev/null)
+            solve=$(echo "$stats" | awk '/^solve_s/ {m=0; for (i=2;i<=NF;i++) if ($i>m) m=$i; print m}')
+            read -r visited busiest imbalance < <(echo "$stats" | awk '/^solve_visited/ {s=0; m=0; for (i=2;i<=NF;i++) { s+=$i; if ($i>m) m=$i }
+                printf "%d %d %.2f\n", s, m, (s > 0 ? m / (s / (NF - 1)) : 0) }')
+            [ -z "$base" ] && base=$solve
+            printf "%-6s %-7s %-6s %-8s %-10s %-12s %-12s %-10s %-8.2f\n" "$seed" "$solver" "$np" "$threads" "$solve" "$visited" "$busiest" "$imbalance" \
+                "$(awk -v a="$base" -v b="$solve" 'BEGIN { print (b > 0 ? a / b : 0) }')"
+        done
+    done
+done
@@ -0,0 +1,82 @@
+// Benchmark: union throughput of the Kruskal union-finds (src/unionfind.hpp) on the edge sequence Kruskal feeds them
+// - The edges of a size x size graph with the node weights of the generator (for_each_weight), ordered by weight with
+//   the counting sort of src/generator/kruskal.cpp, then every edge is offered to unite() until the tree spans the graph
+// - flat: FlatUnionFind (union by size + path halving), one thread, what -g kruskal runs without -t
+// - cas: ConcurrentUnionFind on one thread (the cost of the atomics) and on all OpenMP threads (OMP_NUM_THREADS), one
+//   weight bucket at a time like kruskal_parallel
+// - The tree edge count must be size * size - 1 for every scheme
+// Usage: ./unionfind_bench.out [size ...] (default 2048 4096)
+#include <chrono>
+#include <vector>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "defs.hpp"
+#include "rng.hpp"
+#include "unionfind.hpp"
+
+#define BENCH_SEED 42
+#define BUCKETS 256
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* scheme, int threads, node_t size, double seconds, long long offered, long long joined) {
+    printf("%-6s %7d %6lld %9.3f %10.1f %12lld\n", scheme, threads, (long long)size, seconds, (double)offered / seconds / 1e6, joined);
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<node_t> sizes;
+    for (int i = 1; i < argc; i++) sizes.push_back(atoll(argv[i]));
+    if (sizes.empty()) sizes = {2048, 4096};
+
+    printf("%-6s %7s %6s %9s %10s %12s\n", "scheme", "threads", "size", "seconds", "Munions/s", "tree_edges");
+    for (node_t size : sizes) {
+        node_t cells = size * size;
+        std::vector<uint8_t> weights(cells);
+        for_each_weight(BENCH_SEED, 0, cells, [&](node_t index, int weight) { weights[index] = weight; });
+
+        // Edge ids 2 * node + (1 if DOWN) by weight, as in kruskal.cpp
+        auto for_each_edge = [&](auto f) {
+            for (node_t node = 0; node < cells; node++) {
+                if (node % size < size - 1) f(node, node + 1, 0);
+                if (node / size < size - 1) f(node, node + size, 1);
+            }
+        };
+        std::vector<uint32_t> bucket_start(BUCKETS + 1, 0);
+        for_each_edge([&](node_t a, node_t b, int down) { bucket_start[std::max(weights[a], weights[b]) + 1]++; });
+        for (int b = 0; b < BUCKETS; b++) bucket_start[b + 1] += bucket_start[b];
+        std::vector<uint32_t> next(bucket_start.begin(), bucket_start.end() - 1);
+        std::vector<uint32_t> sorted(bucket_start[BUCKETS]);
+        for_each_edge([&](node_t a, node_t b, int down) { sorted[next[std::max(weights[a], weights[b])]++] = 2 * a + down; });
+        auto neighbour = [&](uint32_t edge) { return (node_t)(edge >> 1) + ((edge & 1) ? size : 1); };
+
+        auto start = std::chrono::steady_clock::now();
+        FlatUnionFind flat(cells);
+        long long joined = 0;
+        size_t i = 0;
+        for (; i < sorted.size() && joined < cells - 1; i++) {
+            joined += flat.unite(sorted[i] >> 1, neighbour(sorted[i]));
+        }
+        report("flat", 1, size, seconds_since(start), i, joined);
+
+        int threads[2] = {1, omp_get_max_threads()};
+        for (int t = 0; t < (threads[1] > 1 ? 2 : 1); t++) {
+            start = std::chrono::steady_clock::now();
+            ConcurrentUnionFind sets(cells);
+            long long joined = 0, offered = 0;
+            for (int b = 0; b < BUCKETS && joined < cells - 1; b++) {
+                #pragma omp parallel for schedule(dynamic, 4096) reduction(+:joined) num_threads(threads[t])
+                for (uint32_t i = bucket_start[b]; i < bucket_start[b + 1]; i++) {
+                    joined += sets.unite(sorted[i] >> 1, neighbour(sorted[i]));
+                }
+                offered = bucket_start[b + 1];
+            }
+            report("cas", threads[t], size, seconds_since(start), offered, joined);
+        }
+    }
+    return 0;
+}
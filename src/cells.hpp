@@ -0,0 +1,202 @@
+#ifndef CELLS_H
+#define CELLS_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "defs.hpp"
+
+// Storage for the per-cell state of the graph / maze
+// - Both types below expose the same accessors, so the generators and solvers are templates over the cell type
+// - PackedCells is the original layout: one 16-bit short per cell holding all the bits described in defs.hpp
+// - BitplaneCells keeps every field in its own plane so that each phase only allocates (and broadcasts) what it uses:
+//   | C/W | visited | visited_by_solver | P | -> 1 bit per cell each
+//   | links | -> 2 bits per cell (right / down tree edge, only while generating)
+//   | parent | -> 2 bits per cell (direction towards the parent, only while solving)
+//   | weight | -> 8 bits per cell (only for kruskal)
+// - Node ids are plain indices into the planes, so the cells don't need to know the grid dimensions
+
+// Planes of BitplaneCells, to select what to allocate / broadcast
+#define PLANE_C 0x01
+#define PLANE_VISITED 0x02
+#define PLANE_VISITED_SOLVE 0x04
+#define PLANE_PATH 0x08
+#define PLANE_PARENT 0x10
+#define PLANE_LINKS 0x20
+#define PLANE_WEIGHT 0x40
+#define PLANE_ALL 0x7F
+
+// Planes needed by each phase
+#define GRAPH_PLANES (PLANE_VISITED | PLANE_LINKS)
+#define MAZE_PLANES (PLANE_C | PLANE_VISITED_SOLVE | PLANE_PATH | PLANE_PARENT)
+
+// Index of a direction bit in a 2-bit plane: DOWN -> 0, UP -> 1, RIGHT -> 2, LEFT -> 3
+#define DIR_INDEX(dir) (__builtin_ctz(dir))
+#define DIR_FROM_INDEX(index) (1 << (index))
+
+class PackedCells {
+public:
+    PackedCells() : n(0) {}
+    PackedCells(node_t n, unsigned planes) : cells(n, 0), n(n) {}
+    PackedCells(PackedCells&&) = default;
+    PackedCells& operator=(PackedCells&&) = default;
+    PackedCells(const PackedCells&) = delete;
+
+    node_t count() const { return n; }
+    short* data() { return cells.data(); }
+
+    bool is_c(node_t node) const { return IS_C(cells[node]); }
+    void set_c(node_t node) { SET_C(cells[node]); }
+    void set_w(node_t node) { SET_W(cells[node]); }
+    bool is_visited(node_t node) const { return IS_VISITED(cells[node]); }
+    void set_visited(node_t node) { SET_VISITED(cells[node]); }
+    bool is_visited_solve(node_t node) const { return IS_VISITED_SOLVE(cells[node]); }
+    void set_visited_solve(node_t node) { SET_VISITED_SOLVE(cells[node]); }
+    bool is_p(node_t node) const { return IS_P(cells[node]); }
+    void set_p(node_t node) { SET_P(cells[node]); }
+
+    // Tree edge between node and its neighbour in direction dir (one of LEFT/RIGHT/UP/DOWN)
+    void connect(node_t node, node_t neighbour, int dir) {
+        cells[node] |= dir;
+        cells[neighbour] |= OPPOSITE_DIR(dir);
+    }
+    bool connected_right(node_t node) const { return GET_RIGHT(cells[node]); }
+    bool connected_down(node_t node) const { return GET_DOWN(cells[node]); }
+
+    // The direction bits are free once the maze is expanded, so the solvers keep the parent direction there
+    int parent_dir(node_t node) const { return cells[node] & 0x0F; }
+    void set_parent_dir(node_t node, int dir) { cells[node] = (cells[node] & ~0x0F) | dir; }
+
+    // set_visited_solve + set_parent_dir from several threads at once: false if the cell was already visited, only the
+    // thread that gets true writes the parent direction
+    bool claim_solve(node_t node, int dir) {
+        short old = __atomic_load_n(&cells[node], __ATOMIC_RELAXED);
+        short next;
+        do {
+            if (IS_VISITED_SOLVE(old)) return false;
+            next = (old & ~0x0F) | dir;
+            SET_VISITED_SOLVE(next);
+        } while (!__atomic_compare_exchange_n(&cells[node], &old, next, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+        return true;
+    }
+
+    bool has_weights() const { return true; }
+    int weight(node_t node) const { return GET_NODE_WEIGHT(cells[node]); }
+    void set_weight(node_t node, int weight) { SET_NODE_WEIGHT(cells[node], weight); }
+
+    // Call f(pointer, bytes) for every buffer holding one of the given planes (everything lives in one buffer here)
+    template <class F>
+    void for_each_plane(unsigned planes, F f) {
+        f((void*)cells.data(), (size_t)n * sizeof(short));
+    }
+
+private:
+    std::vector<short> cells;
+    node_t n;
+};
+
+class BitplaneCells {
+public:
+    BitplaneCells() : n(0), planes(0), c_words(nullptr) {}
+    BitplaneCells(node_t n, unsigned planes) : n(n), planes(planes), c_words(nullptr) {
+        size_t bit_words = (n + 63) / 64;
+        size_t dir_words = (n + 31) / 32;
+        if (planes & PLANE_C) c.assign(bit_words, 0);
+        if (planes & PLANE_VISITED) visited.assign(bit_words, 0);
+        if (planes & PLANE_VISITED_SOLVE) visited_solve.assign(bit_words, 0);
+        if (planes & PLANE_PATH) path.assign(bit_words, 0);
+        if (planes & PLANE_PARENT) parent.assign(dir_words, 0);
+        if (planes & PLANE_LINKS) links.assign(dir_words, 0);
+        if (planes & PLANE_WEIGHT) weights.assign(n, 0);
+        c_words = c.data();
+    }
+    BitplaneCells(BitplaneCells&&) = default;
+    BitplaneCells& operator=(BitplaneCells&&) = default;
+    BitplaneCells(const BitplaneCells&) = delete;
+
+    node_t count() const { return n; }
+
+    bool is_c(node_t node) const { return (c_words[node >> 6] >> (node & 63)) & 1; }
+    void set_c(node_t node) { set_bit(c, node); }
+    void set_w(node_t node) { clear_bit(c, node); }
+
+    // Read the C plane from external memory (e.g. an mmap'd maze file, see mazefile.hpp) instead of an own copy
+    // The plane is read-only from then on (no set_c / set_w / broadcasting it) and words must outlive the cells
+    void map_c(const uint64_t* words) {
+        std::vector<uint64_t>().swap(c);
+        planes |= PLANE_C;
+        c_words = words;
+    }
+    bool is_visited(node_t node) const { return get_bit(visited, node); }
+    void set_visited(node_t node) { set_bit(visited, node); }
+    bool is_visited_solve(node_t node) const { return get_bit(visited_solve, node); }
+    void set_visited_solve(node_t node) { set_bit(visited_solve, node); }
+    bool is_p(node_t node) const { return get_bit(path, node); }
+    void set_p(node_t node) { set_bit(path, node); }
+
+    // Only the right / down edge of each node is stored, a left / up edge is the right / down edge of the neighbour
+    void connect(node_t node, node_t neighbour, int dir) {
+        switch (dir) {
+            case RIGHT: links[node >> 5] |= (uint64_t)LINK_RIGHT << ((node & 31) * 2); break;
+            case LEFT: links[neighbour >> 5] |= (uint64_t)LINK_RIGHT << ((neighbour & 31) * 2); break;
+            case DOWN: links[node >> 5] |= (uint64_t)LINK_DOWN << ((node & 31) * 2); break;
+            case UP: links[neighbour >> 5] |= (uint64_t)LINK_DOWN << ((neighbour & 31) * 2); break;
+        }
+    }
+    bool connected_right(node_t node) const { return get_dir(links, node) & LINK_RIGHT; }
+    bool connected_down(node_t node) const { return get_dir(links, node) & LINK_DOWN; }
+
+    int parent_dir(node_t node) const { return DIR_FROM_INDEX(get_dir(parent, node)); }
+    void set_parent_dir(node_t node, int dir) {
+        uint64_t shift = (node & 31) * 2;
+        parent[node >> 5] = (parent[node >> 5] & ~((uint64_t)3 << shift)) | ((uint64_t)DIR_INDEX(dir) << shift);
+    }
+    // Same as PackedCells::claim_solve, the cells share words here so every write is atomic
+    bool claim_solve(node_t node, int dir) {
+        uint64_t mask = (uint64_t)1 << (node & 63);
+        if ((__atomic_load_n(&visited_solve[node >> 6], __ATOMIC_RELAXED) & mask) ||
+            (__atomic_fetch_or(&visited_solve[node >> 6], mask, __ATOMIC_RELAXED) & mask)) {
+            return false;
+        }
+        uint64_t shift = (node & 31) * 2;
+        uint64_t old = __atomic_load_n(&parent[node >> 5], __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&parent[node >> 5], &old, (old & ~((uint64_t)3 << shift)) | ((uint64_t)DIR_INDEX(dir) << shift),
+                                            true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+        return true;
+    }
+
+    bool has_weights() const { return planes & PLANE_WEIGHT; }
+    int weight(node_t node) const { return weights[node]; }
+    void set_weight(node_t node, int weight) { weights[node] = (uint8_t)weight; }
+
+    // Call f(pointer, bytes) for every allocated plane among the given ones
+    template <class F>
+    void for_each_plane(unsigned mask, F f) {
+        mask &= planes;
+        if (mask & PLANE_C) f((void*)c_words, ((n + 63) / 64) * sizeof(uint64_t));
+        if (mask & PLANE_VISITED) f((void*)visited.data(), visited.size() * sizeof(uint64_t));
+        if (mask & PLANE_VISITED_SOLVE) f((void*)visited_solve.data(), visited_solve.size() * sizeof(uint64_t));
+        if (mask & PLANE_PATH) f((void*)path.data(), path.size() * sizeof(uint64_t));
+        if (mask & PLANE_PARENT) f((void*)parent.data(), parent.size() * sizeof(uint64_t));
+        if (mask & PLANE_LINKS) f((void*)links.data(), links.size() * sizeof(uint64_t));
+        if (mask & PLANE_WEIGHT) f((void*)weights.data(), weights.size());
+    }
+
+private:
+    static const int LINK_RIGHT = 0x1;
+    static const int LINK_DOWN = 0x2;
+
+    static bool get_bit(const std::vector<uint64_t>& plane, node_t node) { return (plane[node >> 6] >> (node & 63)) & 1; }
+    static void set_bit(std::vector<uint64_t>& plane, node_t node) { plane[node >> 6] |= (uint64_t)1 << (node & 63); }
+    static void clear_bit(std::vector<uint64_t>& plane, node_t node) { plane[node >> 6] &= ~((uint64_t)1 << (node & 63)); }
+    static int get_dir(const std::vector<uint64_t>& plane, node_t node) { return (plane[node >> 5] >> ((node & 31) * 2)) & 3; }
+
+    node_t n;
+    unsigned planes;
+    std::vector<uint64_t> c, visited, visited_solve, path, parent, links;
+    std::vector<uint8_t> weights;
+    const uint64_t* c_words; // c.data(), or the external plane given to map_c
+};
+
+#endif // CELLS_H
@@ -1,6 +1,8 @@
 
 #include "defs.hpp"
 #include <stdio.h>
+#include <string.h>
+#include <vector>
 
 
 // ┴ -  Box drawings light up and horizontal
@@ -19,222 +21,131 @@
 // ╵ -  Box drawings light up
 // ╷ -  Box drawings light down
 // · - center dot
-void print_maze_visual(short* edges, int size){
+
+// The symbols above indexed by the direction bits (LEFT | RIGHT | UP | DOWN) of a cell, instead of a chain of ifs
+static const char* BOX_CHARS[16] = {
+    "·", "╷", "╵", "│", "╶", "┌", "└", "├",
+    "╴", "┐", "┘", "┤", "─", "┬", "┴", "┼",
+};
+
+// Rows are built in a buffer and written with one fwrite, a cell is at most this many bytes of UTF-8
+#define MAX_CELL_BYTES 4
+
+static char* append(char* pos, const char* str){
+    size_t len = strlen(str);
+    memcpy(pos, str, len);
+    return pos + len;
+}
+
+static void write_line(std::vector<char>& line, char* end){
+    *end++ = '\n';
+    fwrite(line.data(), 1, end - line.data(), stdout);
+}
+
+void print_maze_visual(short* edges, int width, int height){
     // printf("Printing maze\n");
-    for (int i = 0; i < size; i++){
-        for (int j = 0; j < size; j++){
-            short edge = edges[i * size + j];
-            if (GET_LEFT(edge) == LEFT && GET_RIGHT(edge) == RIGHT && GET_UP(edge) == UP && GET_DOWN(edge) == DOWN){
-                printf("┼");
-            } else if (GET_LEFT(edge) == LEFT && GET_RIGHT(edge) == RIGHT && GET_UP(edge) == UP){
-                printf("┴");
-            } else if (GET_LEFT(edge) == LEFT && GET_RIGHT(edge) == RIGHT && GET_DOWN(edge) == DOWN){
-                printf("┬");
-            } else if (GET_LEFT(edge) == LEFT && GET_UP(edge) == UP && GET_DOWN(edge) == DOWN){
-                printf("┤");
-            } else if (GET_RIGHT(edge) == RIGHT && GET_UP(edge) == UP && GET_DOWN(edge) == DOWN){
-                printf("├");
-            } else if (GET_LEFT(edge) == LEFT && GET_RIGHT(edge) == RIGHT){
-                printf("─");
-            } else if (GET_UP(edge) == UP && GET_DOWN(edge) == DOWN){
-                printf("│");
-            } else if (GET_LEFT(edge) == LEFT && GET_UP(edge) == UP){
-                printf("┘");
-            } else if (GET_LEFT(edge) == LEFT && GET_DOWN(edge) == DOWN){
-                printf("┐");
-            } else if (GET_RIGHT(edge) == RIGHT && GET_UP(edge) == UP){
-                printf("└");
-            } else if (GET_RIGHT(edge) == RIGHT && GET_DOWN(edge) == DOWN){
-                printf("┌");
-            } else if (GET_LEFT(edge) == LEFT){
-                printf("╴");
-            } else if (GET_RIGHT(edge) == RIGHT){
-                printf("╶");
-            } else if (GET_UP(edge) == UP){
-                printf("╵");
-            } else if (GET_DOWN(edge) == DOWN){
-                printf("╷");
-            } else {
-                printf("·");
-            }
+    std::vector<char> line(width * MAX_CELL_BYTES + 1);
+    for (int i = 0; i < height; i++){
+        char* pos = line.data();
+        for (int j = 0; j < width; j++){
+            short edge = edges[NODE(i, j, width)];
+            pos = append(pos, BOX_CHARS[edge & (LEFT | RIGHT | UP | DOWN)]);
         }
-        printf("\n");
+        write_line(line, pos);
     }
 
 }
 
-void print_maze_complete(short* edges, int size) {
-    for (int i = 0; i < size; i++) {
-        for (int j = 0; j < size; j++) {
-            int node = NODE(i, j, size);
+void print_maze_complete(short* edges, int width, int height) {
+    std::vector<char> line(width * MAX_CELL_BYTES + 1);
+    for (int i = 0; i < height; i++) {
+        char* pos = line.data();
+        for (int j = 0; j < width; j++) {
+            node_t node = NODE(i, j, width);
             short edge = edges[node];
 
             if (IS_W(edge)) {
-                printf("█"); // Print a character to represent an opaque block
+                pos = append(pos, "█"); // Print a character to represent an opaque block
             } else {
-                int left_node = LEFT_NODE(node, size);
-                int right_node = RIGHT_NODE(node, size);
-                int up_node = UP_NODE(node, size);
-                int down_node = DOWN_NODE(node, size);
+                node_t left_node = LEFT_NODE(node, width);
+                node_t right_node = RIGHT_NODE(node, width);
+                node_t up_node = UP_NODE(node, width);
+                node_t down_node = DOWN_NODE(node, width, height);
 
                 int has_left = (left_node != -1 && IS_C(edges[left_node]) == 0x20);
                 int has_right = (right_node != -1 && IS_C(edges[right_node]) == 0x20);
                 int has_up = (up_node != -1 && IS_C(edges[up_node]) == 0x20);
                 int has_down = (down_node != -1 && IS_C(edges[down_node]) == 0x20);
 
-                if (has_left && has_right && has_up && has_down) {
-                    printf("┼");
-                } else if (has_left && has_right && has_up) {
-                    printf("┴");
-                } else if (has_left && has_right && has_down) {
-                    printf("┬");
-                } else if (has_left && has_up && has_down) {
-                    printf("┤");
-                } else if (has_right && has_up && has_down) {
-                    printf("├");
-                } else if (has_left && has_right) {
-                    printf("─");
-                } else if (has_up && has_down) {
-                    printf("│");
-                } else if (has_left && has_up) {
-                    printf("┘");
-                } else if (has_left && has_down) {
-                    printf("┐");
-                } else if (has_right && has_up) {
-                    printf("└");
-                } else if (has_right && has_down) {
-                    printf("┌");
-                } else if (has_left) {
-                    printf("╴");
-                } else if (has_right) {
-                    printf("╶");
-                } else if (has_up) {
-                    printf("╵");
-                } else if (has_down) {
-                    printf("╷");
-                } else {
-                    printf("·");
-                }
+                pos = append(pos, BOX_CHARS[(has_left ? LEFT : 0) | (has_right ? RIGHT : 0) | (has_up ? UP : 0) | (has_down ? DOWN : 0)]);
             }
         }
-        printf("\n");
+        write_line(line, pos);
     }
 }
 
-void print_maze(short* maze, int size){
+void print_maze(short* maze, int width, int height){
     // printf("Printing maze\n");
-    for (int i = 0; i < size; i++){
-        for (int j = 0; j < size; j++){
-            // printf("%c", maze[i * size + j] == 0x00 ? 'W' : 'C');
-            short node = maze[i * size + j];
-            if (IS_C(node) == 0x20){
-                printf("□");
-
-                // // if on top edge, print top wall
-                // if (i == 0){
-                //     printf("▔");
-                // // if on left edge, print left wall
-                // } else if (j == 0){
-                //     printf("▏");
-                // // if on right edge, print right wall
-                // } else if (j == size - 1){
-                //     printf("▕");
-                // // if on bottom edge, print bottom wall
-                // } else if (i == size - 1){
-                //     printf("▁");
-                // } else {
-                //     printf("□");
-                // }
-            } else {
-                // printf("█");
-                printf("X");
-            }
+    std::vector<char> line(width * MAX_CELL_BYTES + 1);
+    for (int i = 0; i < height; i++){
+        char* pos = line.data();
+        for (int j = 0; j < width; j++){
+            // printf("%c", maze[NODE(i, j, width)] == 0x00 ? 'W' : 'C');
+            short node = maze[NODE(i, j, width)];
+            pos = append(pos, IS_C(node) == 0x20 ? "□" : "X"); // "█" for walls also works
         }
-        printf("\n");
+        write_line(line, pos);
     }
 }
 
-void print_edges(short* edges, int size){
+void print_edges(short* edges, int width, int height){
     // printf("Printing edges\n");
-    for (int i = 0; i < size; i++){
-        for (int j = 0; j < size; j++){
+    for (int i = 0; i < height; i++){
+        for (int j = 0; j < width; j++){
             // print the last 8 bits of the edge
-            printf("%x ", edges[i * size + j] & 0xFF);
+            printf("%x ", edges[NODE(i, j, width)] & 0xFF);
         }
         printf("\n");
     }
 }
 
-void print_visited(short* edges, int size){
+void print_visited(short* edges, int width, int height){
     // printf("Printing visited\n");
-    for (int i = 0; i < size; i++){
-        for (int j = 0; j < size; j++){
-            if (IS_VISITED(edges[i * size + j])){
-                printf("V");
-            } else {
-                printf("X");
-            }
+    std::vector<char> line(width + 1);
+    for (int i = 0; i < height; i++){
+        for (int j = 0; j < width; j++){
+            line[j] = IS_VISITED(edges[NODE(i, j, width)]) ? 'V' : 'X';
         }
-        printf("\n");
+        write_line(line, line.data() + width);
     }
 }
 
 
-void print_visited_solve(short* edges, int size) {
-    for (int i = 0; i < size; i++) {
-        for (int j = 0; j < size; j++) {
-            int node = NODE(i, j, size);
+void print_visited_solve(short* edges, int width, int height) {
+    std::vector<char> line(width * MAX_CELL_BYTES + 1);
+    for (int i = 0; i < height; i++) {
+        char* pos = line.data();
+        for (int j = 0; j < width; j++) {
+            node_t node = NODE(i, j, width);
             short edge = edges[node];
 
             if (IS_W(edge)) {
-                printf("█"); // Print a character to represent an opaque block
+                pos = append(pos, "█"); // Print a character to represent an opaque block
             } else {
-                int left_node = LEFT_NODE(node, size);
-                int right_node = RIGHT_NODE(node, size);
-                int up_node = UP_NODE(node, size);
-                int down_node = DOWN_NODE(node, size);
+                node_t left_node = LEFT_NODE(node, width);
+                node_t right_node = RIGHT_NODE(node, width);
+                node_t up_node = UP_NODE(node, width);
+                node_t down_node = DOWN_NODE(node, width, height);
 
                 int has_left = (left_node != -1 && IS_VISITED_SOLVE(edges[left_node]));
                 int has_right = (right_node != -1 && IS_VISITED_SOLVE(edges[right_node]));
                 int has_up = (up_node != -1 && IS_VISITED_SOLVE(edges[up_node]));
                 int has_down = (down_node != -1 && IS_VISITED_SOLVE(edges[down_node]));
 
-                if (has_left && has_right && has_up && has_down) {
-                    printf("┼");
-                } else if (has_left && has_right && has_up) {
-                    printf("┴");
-                } else if (has_left && has_right && has_down) {
-                    printf("┬");
-                } else if (has_left && has_up && has_down) {
-                    printf("┤");
-                } else if (has_right && has_up && has_down) {
-                    printf("├");
-                } else if (has_left && has_right) {
-                    printf("─");
-                } else if (has_up && has_down) {
-                    printf("│");
-                } else if (has_left && has_up) {
-                    printf("┘");
-                } else if (has_left && has_down) {
-                    printf("┐");
-                } else if (has_right && has_up) {
-                    printf("└");
-                } else if (has_right && has_down) {
-                    printf("┌");
-                } else if (has_left) {
-                    printf("╴");
-                } else if (has_right) {
-                    printf("╶");
-                } else if (has_up) {
-                    printf("╵");
-                } else if (has_down) {
-                    printf("╷");
-                } else {
-                    printf("·");
-                }
+                pos = append(pos, BOX_CHARS[(has_left ? LEFT : 0) | (has_right ? RIGHT : 0) | (has_up ? UP : 0) | (has_down ? DOWN : 0)]);
             }
         }
-        printf("\n");
+        write_line(line, pos);
     }
     printf("\n");
 }
\ No newline at end of file
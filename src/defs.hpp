@@ -1,11 +1,14 @@
 #ifndef DEFS_H
 #define DEFS_H
 
-// - Nodes of the maze are represented by an integer, 64*row + col
+#include <stdint.h>
+#include <stddef.h>
+
+// - Nodes of the maze are represented by a 64-bit integer, width*row + col (so grids up to 64K x 64K fit)
 // - We make macros to access row no. and col no., neighbors, etc.
 // - make sure that the neighbors macros give valid output, i.e. they don't go out of bounds
 // - Also need a check whether a node is valid or not
-// - We can store edges as 64x64 1d array of short (16bit) where:
+// - We can store edges as width x height 1d array of short (16bit) where:
 //   - last 4 bits value representing whether node is connected to left/right/down/up neighbors
 //   - 5th bit representing whether the node is visited or not
 //   - 6th bit representing whether the node is C or W
@@ -13,16 +16,28 @@
 //   - the top 8 bits representing the weight of the node
 // | visited_by_solver | P | C/W | visited | left | right | up | down | -> bottom 8 bits
 // |                       Weight                     | -> top 8 bits (NOTE: Needed only in kruskal and dijkstra, not in bfs or dfs)
+// Once the maze is expanded the left/right/up/down bits hold the direction of the parent found by the solver
+// See cells.hpp for the bitplane alternative to this layout
 // Now weight of an edge would thus be defined as the maximum of the two nodes connected by the edge
 
+// Node ids are 64-bit so that width*height can exceed 2^31
+typedef int64_t node_t;
+#define MPI_NODE_T MPI_INT64_T
+
+// Limits on the maze dimensions (width and height are given separately, -n sets both)
+#define MIN_MAZE_DIM 4
+#define MAX_MAZE_DIM 65536
+#define DEFAULT_MAZE_DIM 64
+
 // Define macros to access the row and column of the node
-#define ROW(node, n) (node / n)
-#define COL(node, n) (node % n)
-#define NODE(row, col, n) ((n)*(row) + (col))
-#define LEFT_NODE(node, n) (COL(node, n) > 0 ? node - 1 : -1)
-#define RIGHT_NODE(node, n) (COL(node, n) < n-1 ? node + 1 : -1)
-#define UP_NODE(node, n) (ROW(node, n) > 0 ? node - n : -1)
-#define DOWN_NODE(node, n) (ROW(node, n) < n-1 ? node + n : -1)
+// w is the width (number of columns) and h the height (number of rows) of the grid
+#define ROW(node, w) ((node) / (w))
+#define COL(node, w) ((node) % (w))
+#define NODE(row, col, w) ((node_t)(w)*(row) + (col))
+#define LEFT_NODE(node, w) (COL(node, w) > 0 ? (node) - 1 : -1)
+#define RIGHT_NODE(node, w) (COL(node, w) < (w)-1 ? (node) + 1 : -1)
+#define UP_NODE(node, w) (ROW(node, w) > 0 ? (node) - (w) : -1)
+#define DOWN_NODE(node, w, h) (ROW(node, w) < (h)-1 ? (node) + (w) : -1)
 
 // Define macros for accessing the weight of a node
 #define WEIGHT_MASK 0xFF00 // Mask for the top 8 bits (weight)
@@ -39,6 +54,12 @@
 #define UP 0x02
 #define DOWN 0x01
 
+// Opposite of a direction (LEFT <-> RIGHT, UP <-> DOWN)
+#define OPPOSITE_DIR(dir) (((dir) & (LEFT | UP)) ? (dir) >> 1 : (dir) << 1)
+
+// Neighbour of a node in a direction (the caller makes sure it exists)
+#define STEP_NODE(node, dir, w) ((dir) == LEFT ? (node) - 1 : (dir) == RIGHT ? (node) + 1 : (dir) == UP ? (node) - (w) : (node) + (w))
+
 // Define macros for visited
 #define VISITED 0x10
 #define UNWALLED 0x20
@@ -95,22 +116,22 @@
 #define UNSET_P(edges) (edges &= ~0x40)
 
 // Check if node is valid
-#define IS_VALID_NODE(node, n) (ROW(node, n) >= 0 && ROW(node, n) < n && COL(node, n) >= 0 && COL(node, n) < n)
+#define IS_VALID_NODE(node, w, h) ((node) >= 0 && ROW(node, w) < (h) && COL(node, w) < (w))
 
 
 #define MAX_ARG_LEN 16
+#define MAX_PATH_LEN 256
+#define MAX_THREADS 1024
+#define MAX_DELTA (1 << 20)
 
 
 // debug.cpp functions
-void print_maze(short* maze, int size);
-void print_edges(short* edges, int size);
-void print_maze_visual(short* edges, int size);
-void print_maze_complete(short* edges, int size);
-void print_visited(short* edges, int size);
-void print_visited_solve(short* edges, int size);
-
-// maze.cpp functions
+void print_maze(short* maze, int width, int height);
+void print_edges(short* edges, int width, int height);
+void print_maze_visual(short* edges, int width, int height);
+void print_maze_complete(short* edges, int width, int height);
+void print_visited(short* edges, int width, int height);
+void print_visited_solve(short* edges, int width, int height);
 
-void print_maze_final(short* edges, int size, int start, int end);
 
 #endif // DEFS_H
\ No newline at end of file
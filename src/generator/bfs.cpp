@@ -1,14 +1,10 @@
 #include <mpi.h>
 #include <vector>
-#include <queue>
-#include <set>
-#include <unordered_map>
-#include <random>
 #include <algorithm>
-#include <cstddef>
+#include <omp.h>
 #include "bfs.hpp"
-#include <chrono>
-#include <thread>
+#include "rng.hpp"
+#include "mpiutils.hpp"
 
 // - Nodes of the maze are represented by an integer, 64*row + col
 // - We make macros to access row no. and col no., neighbors, etc.
@@ -18,289 +14,204 @@
 // | 0 | 0 | 0 | visited | left | right | up | down | -> 8 bits
 
 
+// Set the bit of node, returns whether it was already set (safe to call from several threads)
+static bool test_and_set(std::vector<uint64_t>& bits, node_t node) {
+    uint64_t mask = (uint64_t)1 << (node & 63);
+    return __atomic_fetch_or(&bits[node >> 6], mask, __ATOMIC_RELAXED) & mask;
+}
+
+// Neighbour of node in direction dir, -1 past the border
+template <class GridT>
+static node_t neighbour_in(const GridT& grid, node_t node, int dir) {
+    switch (dir) {
+        case LEFT: return grid.left(node);
+        case RIGHT: return grid.right(node);
+        case UP: return grid.up(node);
+        default: return grid.down(node);
+    }
+}
+
 // Function to generate a maze using BFS and MPI
-// @param size: The size of the maze
-// @param maze: The array of nodes of the maze, each short is | 0 | 0 | selected | visited | left | right | up | down |
-void generateTreeUsingBFS(int size, short *maze, MPI_Comm comm){
+// @param grid: The topology of the graph (see grid.hpp)
+// @param maze: The cells of the graph (see cells.hpp), uses the visited bit and the tree edges
+// @param seed: All the random choices are drawn from it (see rng.hpp)
+// @param stats: If given, filled in with the number of levels, the time spent exchanging the frontiers and the
+//               direction switches / edge checks
+// @param direction_optimizing: Expand bottom-up on the levels where that is cheaper (see below), else always top-down
+// - Every level, each rank expands its share of the (replicated) frontier and the discovered nodes are exchanged with
+//   one MPI_Allgatherv, as (child << 2 | direction index from the parent) so that a pair costs a single node_t
+// - Every rank then merges the same data in the same (rank) order: the first parent to reach a child wins, which the
+//   visited bitmap decides, so all ranks link the same tree and build the same next frontier without any rank 0 merge
+// - The frontier is shuffled with a generator seeded identically on every rank, so it stays replicated
+// - Splits are contiguous and the merge goes in rank order, i.e. in frontier order, so with one thread per rank the tree
+//   only depends on the seed and not on the number of ranks (threads race for the claims, see below)
+// - Hybrid mode (-t): the top-down expansion of a rank's share runs on the OpenMP threads of the rank, each with its
+//   own buffer, only the master thread talks MPI. One rank per node with a thread per core sends cores times fewer
+//   messages per level than a rank per core
+// - Direction optimizing (Beamer et al.): once the frontier has more edges than the unvisited nodes / BFS_ALPHA, each
+//   rank instead scans its share of the unvisited nodes for a parent in the frontier, stopping at the first one.
+//   On a grid that only happens in the last levels, when the frontier sweeps the corners, and the scan then looks at
+//   more edges than top-down would (most unvisited nodes are not next to the frontier), so it is off by default
+//   (--bfs-dir-opt turns it on, --stats and make bench_bfs_exchange print the counters)
+template <class GridT, class Cells>
+void generateTreeUsingBFS(const GridT& grid, Cells& maze, MPI_Comm comm, uint64_t seed, BFSStats* stats, bool direction_optimizing){
     // Get the rank and size of the communicator
     int rank, commSize;
     MPI_Comm_rank(comm, &rank);
     MPI_Comm_size(comm, &commSize);
-    int start, loop_iter = 0;
-
-    // define the frontier and visited set
-    std::vector<int> global_frontier;
-
-    // For each process
-    std::vector<int> local_frontier; // current frontier for each process
-    std::vector<int> next_local_frontier; // next frontier for each process
-    // We would also need to maintain a list/vector of local_neighbours_paired added (along with with neighbour they are) so that the final maze matrix can be updated before next loop
-    std::unordered_map<int, int> local_neighbours; // key: neighbour_node, value: node from which it was added
-
-
-    // if rank is 0, add the start node to the frontier
-    if (rank == 0){
-        // Get random start node
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<int> dis(0, size * size - 1);
-        start = dis(gen);
-
-        global_frontier.push_back(start);
-    }
-
-    // Broadcast the size of the global frontier
-    int global_frontier_size;
-    if (rank == 0)
-        global_frontier_size = global_frontier.size();
-    MPI_Bcast(&global_frontier_size, 1, MPI_INT, 0, comm);
 
-    // Resize the global_frontier vector on non-root processes
-    if (rank != 0) {
-        global_frontier.resize(global_frontier_size);
-    }
-
-    // Broadcast the global frontier data
-    MPI_Bcast(global_frontier.data(), global_frontier_size, MPI_INT, 0, comm);
-
-    while (true){
-
-        // printing the tree generated step by step
-        // if (rank == 0){
-        //     print_maze_visual(maze, size);
-        //     printf("\n");
-        // }
-        
-        // If the global frontier is empty, break
-        if (global_frontier.size() == 0){
-            break;
+    // Every rank draws the same start node and shuffles the frontier the same way (see rng.hpp)
+    uint64_t start_bits = random_at(seed, RNG_STREAM_BFS, 0);
+    node_t start = grid.node((start_bits >> 32) % grid.height(), (start_bits & 0xFFFFFFFF) % grid.width());
+    PhiloxStream shuffle_gen(seed, RNG_STREAM_BFS_SHUFFLE);
+
+    std::vector<node_t> global_frontier; // same on every rank
+    std::vector<node_t> discovered; // (child << 2 | DIR_INDEX(dir)) found by this rank in this level
+    std::vector<node_t> all_discovered; // discovered of every rank, in rank order
+    std::vector<int> counts(commSize), displs(commSize);
+
+    // Bottom-up state, set up at the first bottom-up level: this rank's share of the unvisited nodes (compacted as they
+    // get visited) and a bitmap of the current frontier
+    bool bottom_up = false;
+    bool unvisited_ready = false;
+    std::vector<node_t> unvisited;
+    std::vector<uint64_t> in_frontier;
+    node_t nodes = (node_t)grid.width() * grid.height();
+    node_t visited_count = 1;
+    int level = 0;
+    static const int DIRS[4] = {LEFT, RIGHT, UP, DOWN};
+
+    // Top-down state: the children claimed by a thread of this rank in the current level, and what every thread found
+    std::vector<uint64_t> claimed((grid.cells() + 63) / 64, 0);
+    std::vector<std::vector<node_t>> thread_discovered(omp_get_max_threads());
+
+    maze.set_visited(start);
+    global_frontier.push_back(start);
+
+    while (!global_frontier.empty()){
+        // Pick the direction, from data every rank has so they all agree
+        // Every node has up to 4 edges, so comparing node counts is comparing edge counts
+        node_t frontier_size = global_frontier.size();
+        bool next_bottom_up = direction_optimizing && frontier_size > (nodes - visited_count) / BFS_ALPHA;
+        if (stats != nullptr && next_bottom_up != bottom_up) {
+            stats->switch_levels.push_back(level);
         }
-
-        // Set the visted bit of the nodes in the global frontier
-        for (int node : global_frontier){
-            SET_VISITED(maze[node]);
-        }
-
-        // Clear the next local frontier
-        local_frontier.clear();
-        next_local_frontier.clear();
-
-        // Split the global frontier into local frontiers per proc
-        int local_frontier_size = global_frontier.size() / commSize + (rank < (int)(global_frontier.size() % commSize) ? 1 : 0);
-        for (int i = 0; i < local_frontier_size; i++){
-            local_frontier.push_back(global_frontier[i + rank * local_frontier_size]);
-        }
-
-        // For each node in the local frontier, add the neighbors to the next local frontier if they are not visited
-        // Set them as visited for current proc (we dont want to check the nodes again in case they are a neighbour of another node in the local frontier)
-
-        for (int node : local_frontier) {
-
-            int neighbour_node;
-            // Add the neighbors to the next local frontier if they are not visited
-            if ((neighbour_node = LEFT_NODE(node, size)) != -1 && !IS_VISITED(maze[neighbour_node])) {
-                next_local_frontier.push_back(neighbour_node);
-                local_neighbours[neighbour_node] = node;
-                SET_VISITED(maze[neighbour_node]);
-                
-            }
-            if ((neighbour_node = RIGHT_NODE(node, size)) != -1 && !IS_VISITED(maze[neighbour_node])) {
-                next_local_frontier.push_back(neighbour_node);
-                local_neighbours[neighbour_node] = node;
-                SET_VISITED(maze[neighbour_node]);
-            }
-            if ((neighbour_node = UP_NODE(node, size)) != -1 && !IS_VISITED(maze[neighbour_node])) {
-                next_local_frontier.push_back(neighbour_node);
-                local_neighbours[neighbour_node] = node;
-                SET_VISITED(maze[neighbour_node]);
+        bottom_up = next_bottom_up;
+
+        discovered.clear();
+        if (!bottom_up) {
+            // Expand this rank's share of the frontier, split again over the threads of the rank
+            // A child claimed by one thread (atomic test-and-set in claimed) is not sent again by another, but children
+            // are not marked visited here: another rank may reach them in the same level and all ranks have to agree on
+            // the winner, so a child can still be sent once per rank and is deduped below
+            node_t first = split_offset(frontier_size, rank, commSize);
+            node_t last = split_offset(frontier_size, rank + 1, commSize);
+            long long checks = 0;
+            #pragma omp parallel reduction(+:checks)
+            {
+                std::vector<node_t>& local = thread_discovered[omp_get_thread_num()];
+                local.clear();
+                #pragma omp for schedule(static)
+                for (node_t i = first; i < last; i++) {
+                    grid.for_each_neighbour(global_frontier[i], [&](node_t neighbour_node, int dir) {
+                        checks++;
+                        if (!maze.is_visited(neighbour_node) && !test_and_set(claimed, neighbour_node)) {
+                            local.push_back(neighbour_node << 2 | DIR_INDEX(dir));
+                        }
+                        return false;
+                    });
+                }
             }
-            if ((neighbour_node = DOWN_NODE(node, size)) != -1 && !IS_VISITED(maze[neighbour_node])) {
-                next_local_frontier.push_back(neighbour_node);
-                local_neighbours[neighbour_node] = node;
-                SET_VISITED(maze[neighbour_node]);
+            for (std::vector<node_t>& local : thread_discovered) {
+                discovered.insert(discovered.end(), local.begin(), local.end());
             }
-        }
-
-        // Clear the global frontier
-        global_frontier.clear();
-
-        // Next part is to merge the next local frontiers of each proc into the global frontier
-
-
-        //! For now, we're just sending all info directly to proc 0 and then manually creating the global_frontier (no standard MPI merge function) 
-        //! This is ok for now because there are only going to be 4 processes   
-        if (rank == 0) {
-            // Make a set instead of vector (to avoid duplicates)
-            std::set<int> global_frontier_temp;
-
-            // Insert the next local frontier of proc 0
-            global_frontier_temp.insert(next_local_frontier.begin(), next_local_frontier.end());
-            
-            // Receive the next local frontiers of other processes and insert them into the set
-            for (int i = 1; i < commSize; i++) {
-
-                // receive the size of the message to receive next
-                int temp_size;
-                MPI_Recv(&temp_size, 1, MPI_INT, i, 0, comm, MPI_STATUS_IGNORE);
-                
-                // receive the next_local_frontier of each process
-                std::vector<int> temp(temp_size);
-                MPI_Recv(temp.data(), temp_size, MPI_INT, i, 0, comm, MPI_STATUS_IGNORE);
-
-                // insert to global_frontier_temp set to avoid duplicates
-                global_frontier_temp.insert(temp.begin(), temp.end());
+            for (node_t entry : discovered) {
+                node_t child = entry >> 2;
+                claimed[child >> 6] &= ~((uint64_t)1 << (child & 63));
             }
-
-            // Convert the set to vector
-            global_frontier.assign(global_frontier_temp.begin(), global_frontier_temp.end());
-            std::random_shuffle(global_frontier.begin(), global_frontier.end());
+            if (stats != nullptr) stats->edge_checks += checks;
         } else {
-            // for other processes
-            int next_local_frontier_size = next_local_frontier.size();
-            // send size of message
-            MPI_Send(&next_local_frontier_size, 1, MPI_INT, 0, 0, comm);
-            // send the next_local_frontier
-            MPI_Send(next_local_frontier.data(), next_local_frontier_size, MPI_INT, 0, 0, comm);
-        }
-
-        // Broadcast the size of the global_frontier
-        int global_frontier_size;
-        if (rank == 0) {
-            global_frontier_size = global_frontier.size();
-        }
-
-        // Broadcast the size of the global_frontier
-        MPI_Bcast(&global_frontier_size, 1, MPI_INT, 0, comm);
-
-        // Resize the global_frontier vector on non-root processes
-        if (rank != 0) {
-            global_frontier.resize(global_frontier_size);
-        }
-
-        // Broadcast the global_frontier data
-        MPI_Bcast(global_frontier.data(), global_frontier_size, MPI_INT, 0, comm);
-
-        //& debugging statments -> remove later
-        //printf("Rank: %d, start after iteration: %d\n", rank, global_frontier[0]);
-
-        // Now we need to get the local_neighbours from all the processes and update the maze for each of them
-        // We can do this by sending the local_neighbours from each process to process 0 and Broadcasting it to all processes
-        // Then each process can update the maze accordingly
-        // We would probably need to create a new MPI data type for the unordered_map
-        //! CHECK IF THE BELOW PART IS PROPERLY CREATED
-        // Define a struct that has standard layout
-        struct Pair {
-            int first;
-            int second;
-
-            bool operator<(const Pair& other) const {
-                return (first < other.first) || (first == other.first && second < other.second);
-            }
-        };
-
-        // Create a custom MPI datatype for Pair
-        MPI_Datatype MPI_PAIR;
-        int blocklengths[] = {1, 1};
-        MPI_Aint displacements[] = {offsetof(Pair, first), offsetof(Pair, second)};
-        MPI_Datatype types[] = {MPI_INT, MPI_INT};
-        MPI_Type_create_struct(2, blocklengths, displacements, types, &MPI_PAIR);
-        MPI_Type_commit(&MPI_PAIR);
-
-        // local_neighbours - hashmap of child : parent, added by each process
-        // local_neighbours_paired - vector of pairs of child : parent, to be sent to process 0
-        // global_neighbours - final set of all neighbours to be broadcasted
-
-        std::vector<Pair> global_neighbours;
-
-        // Convert the std::pair<int, int> from the hashmap to Pair
-        std::vector<Pair> local_neighbours_paired(local_neighbours.size());
-        std::transform(local_neighbours.begin(), local_neighbours.end(), local_neighbours_paired.begin(),
-                    [](const std::pair<int, int>& p) { return Pair{p.first, p.second}; });
-
-        if (rank == 0) {
-            // temporary one to hold all the neighbours from all processes, to 
-            std::set<Pair> global_neighbours_temp;
-            // neighbours_seen - set of all neighbours added by all processes (to avoid duplicates)
-            std::set<int> neighbours_seen;
-
-            // just for proc 0
-            for (auto it = local_neighbours_paired.begin(); it != local_neighbours_paired.end(); it++) {
-                if (neighbours_seen.find(it->first) == neighbours_seen.end()) {
-                    // checking if the first element of the pair (the child) is already in the set
-                    // if not seen, insert into the set and the global_neighbours_temp
-                    global_neighbours_temp.insert(*it);
-                    neighbours_seen.insert(it->first);
-                    // We do this checking to prevent cycles in the maze, where different parents from different processes try to add the same child
-                }
+            if (!unvisited_ready) {
+                node_t index = 0;
+                node_t first = split_offset(nodes, rank, commSize);
+                node_t last = split_offset(nodes, rank + 1, commSize);
+                grid.for_each_cell([&](node_t node, node_t row, node_t col) {
+                    if (index >= first && index < last && !maze.is_visited(node)) unvisited.push_back(node);
+                    index++;
+                });
+                in_frontier.assign((grid.cells() + 63) / 64, 0);
+                unvisited_ready = true;
             }
-
-            // Receive the local_neighbours_paired of other processes and insert them into the set
-            for (int i = 1; i < commSize; i++) {
-                int temp_size;
-                MPI_Recv(&temp_size, 1, MPI_INT, i, 0, comm, MPI_STATUS_IGNORE);
-                std::vector<Pair> temp(temp_size);
-                MPI_Recv(temp.data(), temp_size, MPI_PAIR, i, 0, comm, MPI_STATUS_IGNORE);
-
-                // similar to before, check if the first element of the pair is already in the set
-                for (auto it = temp.begin(); it != temp.end(); it++) {
-                    if (neighbours_seen.find(it->first) == neighbours_seen.end()) {
-                        global_neighbours_temp.insert(*it);
-                        neighbours_seen.insert(it->first);
+            for (node_t node : global_frontier) in_frontier[node >> 6] |= (uint64_t)1 << (node & 63);
+
+            // Every unvisited node of this rank looks for a parent in the frontier, starting from a random side
+            // Nodes are owned by one rank here, so nothing is sent twice (this runs on the master thread only)
+            long long checks = 0;
+            size_t kept = 0;
+            for (node_t node : unvisited) {
+                if (maze.is_visited(node)) continue;
+                int first_dir = random_at(seed, RNG_STREAM_BFS_BOTTOM_UP, (uint64_t)level << 40 | node) & 3;
+                bool found = false;
+                for (int k = 0; k < 4 && !found; k++) {
+                    int dir = DIRS[(first_dir + k) & 3];
+                    node_t parent = neighbour_in(grid, node, dir);
+                    if (parent == -1) continue;
+                    checks++;
+                    if ((in_frontier[parent >> 6] >> (parent & 63)) & 1) {
+                        discovered.push_back(node << 2 | DIR_INDEX(OPPOSITE_DIR(dir)));
+                        found = true;
                     }
                 }
+                if (!found) unvisited[kept++] = node;
+            }
+            unvisited.resize(kept);
+
+            for (node_t node : global_frontier) in_frontier[node >> 6] &= ~((uint64_t)1 << (node & 63));
+            if (stats != nullptr) {
+                stats->edge_checks += checks;
+                // What top-down would have checked for this rank's share of the frontier
+                stats->top_down_checks += 4 * (split_offset(frontier_size, rank + 1, commSize) - split_offset(frontier_size, rank, commSize));
+                stats->bottom_up_checks += checks;
+                stats->bottom_up_levels++;
             }
-
-            // Moving the values of the temp set to the main global_neighbours vector
-            global_neighbours.assign(global_neighbours_temp.begin(), global_neighbours_temp.end());
-
-        } else {
-            int global_neighbours_size = local_neighbours_paired.size();
-            MPI_Send(&global_neighbours_size, 1, MPI_INT, 0, 0, comm);
-            MPI_Send(local_neighbours_paired.data(), global_neighbours_size, MPI_PAIR, 0, 0, comm);
         }
 
-        // Broadcast the size of the local_neighbours_paired
-        int global_neighbours_size;
-        if (rank == 0) {
-            global_neighbours_size = global_neighbours.size();
+        // Exchange: everyone gets everything that was discovered
+        double t0 = MPI_Wtime();
+        int count = discovered.size();
+        MPI_Allgather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+        int total = 0;
+        for (int i = 0; i < commSize; i++) {
+            displs[i] = total;
+            total += counts[i];
         }
-
-        MPI_Bcast(&global_neighbours_size, 1, MPI_INT, 0, comm);
-
-        // Resize the local_neighbours_paired vector on non-root processes
-        if (rank != 0) {
-            global_neighbours.resize(global_neighbours_size);
+        all_discovered.resize(total);
+        MPI_Allgatherv(discovered.data(), count, MPI_NODE_T, all_discovered.data(), counts.data(), displs.data(), MPI_NODE_T, comm);
+        if (stats != nullptr) {
+            stats->exchange_s += MPI_Wtime() - t0;
+            stats->levels++;
         }
 
-        // Broadcast the local_neighbours_paired data
-        MPI_Bcast(global_neighbours.data(), global_neighbours_size, MPI_PAIR, 0, comm);
-
-        // Free the custom MPI datatype
-        MPI_Type_free(&MPI_PAIR);
-
-        // Update the maze for each process
-        for (auto it = global_neighbours.begin(); it != global_neighbours.end(); it++){
-            int neighbour_node = it->first;
-            int node = it->second;
-            if (LEFT_NODE(node, size) == neighbour_node){
-                // if the left of node is neighbour_node
-                SET_LEFT(maze[node]);
-                SET_RIGHT(maze[neighbour_node]);
-            } else if (RIGHT_NODE(node, size) == neighbour_node){
-                SET_RIGHT(maze[node]);
-                SET_LEFT(maze[neighbour_node]);
-            } else if (UP_NODE(node, size) == neighbour_node){
-                SET_UP(maze[node]);
-                SET_DOWN(maze[neighbour_node]);
-            } else if (DOWN_NODE(node, size) == neighbour_node){
-                SET_DOWN(maze[node]);
-                SET_UP(maze[neighbour_node]);
+        // Merge: dedupe by the visited bitmap and link every new child to its parent
+        global_frontier.clear();
+        for (node_t entry : all_discovered) {
+            node_t child = entry >> 2;
+            if (maze.is_visited(child)) {
+                continue;
             }
+            int dir = DIR_FROM_INDEX(entry & 3);
+            maze.set_visited(child);
+            maze.connect(grid.step(child, OPPOSITE_DIR(dir)), child, dir);
+            global_frontier.push_back(child);
         }
-
-        loop_iter++;
+        visited_count += global_frontier.size();
+        level++;
+        std::shuffle(global_frontier.begin(), global_frontier.end(), shuffle_gen);
     }
 
     // The tree has now been generated and is stored in the maze
 
-}
\ No newline at end of file
+}
+
+#define INSTANTIATE_BFS(GridT, Cells) template void generateTreeUsingBFS<GridT, Cells>(const GridT& grid, Cells& maze, MPI_Comm comm, uint64_t seed, BFSStats* stats, bool direction_optimizing);
+FOR_EACH_GRAPH_TYPE(INSTANTIATE_BFS)
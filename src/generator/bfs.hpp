@@ -1,3 +1,21 @@
 #include <mpi.h>
 #include "defs.hpp"
-void generateTreeUsingBFS(int size, short *maze, MPI_Comm comm);
\ No newline at end of file
+#include "cells.hpp"
+#include "grid.hpp"
+#include <vector>
+
+// Direction optimizing BFS: go bottom-up while the frontier has more than 1 / BFS_ALPHA as many nodes as are unvisited
+#define BFS_ALPHA 14
+
+// Counters of generateTreeUsingBFS (filled in when a pointer is given), the edge checks are this rank's
+struct BFSStats {
+    int levels = 0;
+    double exchange_s = 0; // Time spent in the per-level frontier exchange
+    std::vector<int> switch_levels; // Levels at which the direction changed (top-down -> bottom-up and back)
+    int bottom_up_levels = 0;
+    long long edge_checks = 0; // Neighbours looked at, both directions
+    long long bottom_up_checks = 0; // ... in the bottom-up levels
+    long long top_down_checks = 0; // ... that top-down would have needed in those levels instead
+};
+template <class GridT, class Cells>
+void generateTreeUsingBFS(const GridT& grid, Cells& maze, MPI_Comm comm, uint64_t seed, BFSStats* stats = nullptr, bool direction_optimizing = false);
\ No newline at end of file
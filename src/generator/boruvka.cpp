@@ -0,0 +1,277 @@
+#include <mpi.h>
+#include <vector>
+#include <algorithm>
+#include "boruvka.hpp"
+
+/* Distributed minimum spanning tree by contracting regions of rows (Boruvka style, a Kruskal pass per contraction)
+- Edges are ordered by weight (GET_EDGE_WEIGHT: max of the two node weights), ties broken by edge id, so the minimum
+  spanning tree is unique and does not depend on the number of ranks:
+  key = weight << KEY_ID_BITS | edge id, edge id = 2 * (row * width + col) + (0 for the right edge, 1 for the down edge)
+- Every rank owns a block of graph rows (a region) and contracts it on its own: a Kruskal pass over the edges inside it,
+  where the edges leaving the region are "stoppers". Once a component has met a stopper its lightest outgoing edge may be
+  outside, so an edge is only taken while one of its two components has not (it is then the lightest edge leaving that
+  component, i.e. in the tree by the cut property). Edges between two stopped components are kept for later
+- What is left of a region is small: the components of its first and last row and the kept edges between components
+  (at most one per pair), O(width) whatever the number of rows
+- Rounds: in round k rank r (r % 2^(k+1) == 0) receives what is left of the region below from rank r + 2^k, the two are
+  contracted together the same way (the edges between them are now inside, the stoppers are the rows above / below the
+  pair) and rank r + 2^k is done. After log2(ranks) rounds rank 0 holds the whole graph, which has no stoppers left
+- Every rank sends the edges it took to rank 0, which links the tree
+*/
+
+#define KEY_ID_BITS 48
+#define KEY_ID_MASK (((uint64_t)1 << KEY_ID_BITS) - 1)
+#define BORUVKA_REGION_TAG 3
+
+// Edge between two components of a region being contracted (b == -1: stopper, an edge leaving the region from a)
+struct ContractEdge {
+    uint64_t key;
+    int32_t a, b;
+};
+
+// What is left of a region of rows once contracted
+struct Region {
+    node_t top = 0, bottom = 0; // graph rows [top, bottom)
+    std::vector<node_t> top_labels, bottom_labels; // component of every node of the first / last row
+    std::vector<uint64_t> edges; // kept edges between components, 3 words each: key, component a, component b
+};
+
+// Components are labelled by the row-major id of one of their nodes, so labels are unique across ranks
+
+// Union-find over the components of a region, with the stopped flag of every root
+class Contraction {
+public:
+    explicit Contraction(int32_t n) : parent(n), stopped(n, 0) {
+        for (int32_t i = 0; i < n; i++) parent[i] = i;
+    }
+
+    int32_t find(int32_t x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    // Kruskal with stoppers (see above), the ids of the edges taken go to accepted, the edges between two stopped
+    // components to kept (in key order)
+    void run(std::vector<ContractEdge>& edges, std::vector<node_t>& accepted, std::vector<ContractEdge>& kept) {
+        std::sort(edges.begin(), edges.end(), [](const ContractEdge& x, const ContractEdge& y) { return x.key < y.key; });
+        for (const ContractEdge& e : edges) {
+            int32_t ra = find(e.a);
+            if (e.b < 0) {
+                stopped[ra] = 1;
+                continue;
+            }
+            int32_t rb = find(e.b);
+            if (ra == rb) continue; // heaviest edge of a cycle
+            if (stopped[ra] && stopped[rb]) {
+                kept.push_back(e);
+                continue;
+            }
+            accepted.push_back(e.key & KEY_ID_MASK);
+            parent[rb] = ra;
+            stopped[ra] |= stopped[rb];
+        }
+    }
+
+private:
+    std::vector<int32_t> parent;
+    std::vector<char> stopped;
+};
+
+// Key of the right / down edge of graph node (row, col)
+template <class GridT, class Cells>
+static uint64_t edge_key(const GridT& grid, const Cells& maze, node_t row, node_t col, int dir) {
+    node_t node = grid.node(row, col);
+    node_t neighbour = dir == RIGHT ? grid.node(row, col + 1) : grid.node(row + 1, col);
+    uint64_t weight = std::max(maze.weight(node), maze.weight(neighbour));
+    return weight << KEY_ID_BITS | (uint64_t)(2 * (row * grid.width() + col) + (dir == DOWN));
+}
+
+// Fill in out from a finished contraction: boundary rows and kept edges relabelled to their component, keeping the
+// lightest edge between two components (a heavier one closes a cycle with it)
+// label(i) is the label of dense component i, top(col) / bottom(col) the dense component of the first / last row
+template <class Label, class Top, class Bottom>
+static void finish_region(Contraction& uf, Label label, Top top, Bottom bottom, std::vector<ContractEdge>& kept, node_t width, Region& out) {
+    out.top_labels.resize(width);
+    out.bottom_labels.resize(width);
+    for (node_t col = 0; col < width; col++) {
+        out.top_labels[col] = label(uf.find(top(col)));
+        out.bottom_labels[col] = label(uf.find(bottom(col)));
+    }
+
+    for (ContractEdge& e : kept) {
+        e.a = uf.find(e.a);
+        e.b = uf.find(e.b);
+        if (e.a > e.b) std::swap(e.a, e.b);
+    }
+    std::stable_sort(kept.begin(), kept.end(), [](const ContractEdge& x, const ContractEdge& y) {
+        return x.a < y.a || (x.a == y.a && x.b < y.b);
+    });
+    out.edges.clear();
+    for (size_t i = 0; i < kept.size(); i++) {
+        if (kept[i].a == kept[i].b) continue;
+        if (i > 0 && kept[i].a == kept[i - 1].a && kept[i].b == kept[i - 1].b) continue;
+        out.edges.push_back(kept[i].key);
+        out.edges.push_back(label(kept[i].a));
+        out.edges.push_back(label(kept[i].b));
+    }
+}
+
+// Contract the graph rows [top, bottom) owned by this rank
+template <class GridT, class Cells>
+static void contract_rows(const GridT& grid, const Cells& maze, node_t top, node_t bottom, std::vector<node_t>& accepted, Region& out) {
+    node_t width = grid.width();
+    node_t height = grid.height();
+    std::vector<ContractEdge> edges;
+    edges.reserve(2 * (bottom - top) * width + 2 * width);
+    for (node_t row = top; row < bottom; row++) {
+        for (node_t col = 0; col < width; col++) {
+            int32_t i = (row - top) * width + col;
+            if (col + 1 < width) edges.push_back({edge_key(grid, maze, row, col, RIGHT), i, i + 1});
+            if (row + 1 < height) edges.push_back({edge_key(grid, maze, row, col, DOWN), i, row + 1 < bottom ? i + (int32_t)width : -1});
+            if (row == top && top > 0) edges.push_back({edge_key(grid, maze, row - 1, col, DOWN), i, -1});
+        }
+    }
+
+    Contraction uf((bottom - top) * width);
+    std::vector<ContractEdge> kept;
+    uf.run(edges, accepted, kept);
+    std::vector<ContractEdge>().swap(edges);
+
+    out.top = top;
+    out.bottom = bottom;
+    finish_region(uf, [&](int32_t i) { return top * width + i; },
+        [&](node_t col) { return (int32_t)col; },
+        [&](node_t col) { return (int32_t)((bottom - 1 - top) * width + col); }, kept, width, out);
+}
+
+// Contract two adjacent regions (upper.bottom == lower.top) into one
+template <class GridT, class Cells>
+static void merge_regions(const GridT& grid, const Cells& maze, const Region& upper, const Region& lower, std::vector<node_t>& accepted, Region& out) {
+    node_t width = grid.width();
+    node_t height = grid.height();
+
+    // Dense ids of the components involved
+    std::vector<node_t> labels;
+    for (const Region* region : {&upper, &lower}) {
+        labels.insert(labels.end(), region->top_labels.begin(), region->top_labels.end());
+        labels.insert(labels.end(), region->bottom_labels.begin(), region->bottom_labels.end());
+        for (size_t i = 0; i < region->edges.size(); i += 3) {
+            labels.push_back(region->edges[i + 1]);
+            labels.push_back(region->edges[i + 2]);
+        }
+    }
+    std::sort(labels.begin(), labels.end());
+    labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+    auto dense = [&](node_t label) { return (int32_t)(std::lower_bound(labels.begin(), labels.end(), label) - labels.begin()); };
+
+    std::vector<ContractEdge> edges;
+    for (const Region* region : {&upper, &lower}) {
+        for (size_t i = 0; i < region->edges.size(); i += 3) {
+            edges.push_back({region->edges[i], dense(region->edges[i + 1]), dense(region->edges[i + 2])});
+        }
+    }
+    for (node_t col = 0; col < width; col++) {
+        // The edges between the two regions, and the stoppers above / below the pair
+        edges.push_back({edge_key(grid, maze, upper.bottom - 1, col, DOWN), dense(upper.bottom_labels[col]), dense(lower.top_labels[col])});
+        if (upper.top > 0) edges.push_back({edge_key(grid, maze, upper.top - 1, col, DOWN), dense(upper.top_labels[col]), -1});
+        if (lower.bottom < height) edges.push_back({edge_key(grid, maze, lower.bottom - 1, col, DOWN), dense(lower.bottom_labels[col]), -1});
+    }
+
+    Contraction uf(labels.size());
+    std::vector<ContractEdge> kept;
+    uf.run(edges, accepted, kept);
+
+    out.top = upper.top;
+    out.bottom = lower.bottom;
+    finish_region(uf, [&](int32_t i) { return labels[i]; },
+        [&](node_t col) { return dense(upper.top_labels[col]); },
+        [&](node_t col) { return dense(lower.bottom_labels[col]); }, kept, width, out);
+}
+
+// Region <-> message: top, bottom, number of kept edge words, top labels, bottom labels, kept edges
+static std::vector<uint64_t> pack_region(const Region& region) {
+    std::vector<uint64_t> message = {(uint64_t)region.top, (uint64_t)region.bottom, region.edges.size()};
+    message.insert(message.end(), region.top_labels.begin(), region.top_labels.end());
+    message.insert(message.end(), region.bottom_labels.begin(), region.bottom_labels.end());
+    message.insert(message.end(), region.edges.begin(), region.edges.end());
+    return message;
+}
+
+static void unpack_region(const std::vector<uint64_t>& message, node_t width, Region& region) {
+    region.top = message[0];
+    region.bottom = message[1];
+    size_t labels = region.top < region.bottom ? width : 0;
+    const uint64_t* p = message.data() + 3;
+    region.top_labels.assign(p, p + labels);
+    region.bottom_labels.assign(p + labels, p + 2 * labels);
+    region.edges.assign(p + 2 * labels, p + 2 * labels + message[2]);
+}
+
+// Function to generate a maze using a distributed minimum spanning tree (see above)
+// @param grid: The topology of the graph (see grid.hpp)
+// @param maze: The cells of the graph (see cells.hpp), uses the node weights and the tree edges
+template <class GridT, class Cells>
+void generateTreeUsingBoruvka(const GridT& grid, Cells& maze, MPI_Comm comm) {
+    int rank, commSize;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &commSize);
+    node_t width = grid.width();
+    node_t height = grid.height();
+
+    // Rows split like the frontiers elsewhere, ranks past the last row get an empty region
+    auto first_row = [&](int r) { return r * (height / commSize) + std::min<node_t>(r, height % commSize); };
+    std::vector<node_t> accepted;
+    Region region;
+    region.top = region.bottom = first_row(rank);
+    if (first_row(rank + 1) > first_row(rank)) {
+        contract_rows(grid, maze, first_row(rank), first_row(rank + 1), accepted, region);
+    }
+
+    for (int step = 1; step < commSize; step *= 2) {
+        if (rank % (2 * step) == step) {
+            std::vector<uint64_t> message = pack_region(region);
+            MPI_Send(message.data(), message.size(), MPI_UINT64_T, rank - step, BORUVKA_REGION_TAG, comm);
+            break;
+        }
+        if (rank + step < commSize) {
+            MPI_Status status;
+            int count;
+            MPI_Probe(rank + step, BORUVKA_REGION_TAG, comm, &status);
+            MPI_Get_count(&status, MPI_UINT64_T, &count);
+            std::vector<uint64_t> message(count);
+            MPI_Recv(message.data(), count, MPI_UINT64_T, rank + step, BORUVKA_REGION_TAG, comm, MPI_STATUS_IGNORE);
+            Region lower, merged;
+            unpack_region(message, width, lower);
+            if (lower.top < lower.bottom) {
+                merge_regions(grid, maze, region, lower, accepted, merged);
+                region = std::move(merged);
+            }
+        }
+    }
+
+    // Rank 0 links the tree
+    int count = accepted.size();
+    std::vector<int> counts(commSize), displs(commSize);
+    MPI_Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+    int total = 0;
+    for (int i = 0; i < commSize; i++) {
+        displs[i] = total;
+        total += counts[i];
+    }
+    std::vector<node_t> tree(rank == 0 ? total : 0);
+    MPI_Gatherv(accepted.data(), count, MPI_NODE_T, tree.data(), counts.data(), displs.data(), MPI_NODE_T, 0, comm);
+    if (rank == 0) {
+        for (node_t id : tree) {
+            node_t row = (id >> 1) / width;
+            node_t col = (id >> 1) % width;
+            if (id & 1) maze.connect(grid.node(row, col), grid.node(row + 1, col), DOWN);
+            else maze.connect(grid.node(row, col), grid.node(row, col + 1), RIGHT);
+        }
+    }
+}
+
+#define INSTANTIATE_BORUVKA(GridT, Cells) template void generateTreeUsingBoruvka<GridT, Cells>(const GridT& grid, Cells& maze, MPI_Comm comm);
+FOR_EACH_GRAPH_TYPE(INSTANTIATE_BORUVKA)
@@ -0,0 +1,6 @@
+#include <mpi.h>
+#include "defs.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
+template <class GridT, class Cells>
+void generateTreeUsingBoruvka(const GridT& grid, Cells& maze, MPI_Comm comm);
\ No newline at end of file
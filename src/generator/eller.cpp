@@ -0,0 +1,138 @@
+#include <mpi.h>
+#include <vector>
+#include <random>
+#include "eller.hpp"
+#include "rng.hpp"
+
+/* Eller's algorithm
+* - Only the current row is kept: which set (tree) every cell of the row belongs to
+* - For every row:
+*   - Randomly link horizontally adjacent cells that are in different sets (merging the sets),
+*     on the last row link all of them so that everything ends up in one tree
+*   - Randomly link cells down to the next row, every set needs at least one down link or it would be cut off
+*   - The cells of the next row that got a down link stay in the set of the cell above, the others are new sets
+* - The sets of a row are a union-find over the columns (parent = column index), rebuilt for every row with depth 1
+* - Rows are handed to the sink as soon as they are done, so the whole graph is never in memory
+* - With close = false the last row is left open instead: random horizontal links like any other row and exactly one
+*   down link per set. The sets of the last row are separate trees, each hanging onto the next row by one edge, so
+*   another block of rows generated on its own below (starting with singleton sets) can be attached without cycles,
+*   and the rows stay connected as long as the block at the bottom closes its last row. This is what lets every rank
+*   generate its own slab of the maze (see generateSlabUsingEller)
+*/
+
+static int32_t find_set(std::vector<int32_t>& set, int32_t col) {
+    while (set[col] != col) {
+        set[col] = set[set[col]];
+        col = set[col];
+    }
+    return col;
+}
+
+void generateRowsUsingEller(node_t width, node_t height, std::mt19937_64& gen, const EllerRowSink& sink, bool close) {
+    // The graph is at most MAX_MAZE_DIM / 2 wide, so columns fit in 32 bits (half the cache footprint of node_t)
+    std::vector<int32_t> set(width); // Union-find over the columns of the current row
+    std::vector<int32_t> next_set(width);
+    std::vector<int32_t> first_below(width); // Per set: first column of the next row linked to it
+    std::vector<int32_t> members(width); // Per set: number of members in the row
+    std::vector<int32_t> chosen(width); // Per set without a down link: members left to skip before the forced one
+    std::vector<char> has_down(width);
+    std::vector<char> right(width), down(width);
+
+    for (node_t col = 0; col < width; col++) {
+        set[col] = col;
+    }
+
+    for (node_t row = 0; row < height; row++) {
+        bool last_row = row == height - 1;
+        bool closing_row = last_row && close;
+
+        // Horizontal links
+        for (node_t col = 0; col < width; col++) {
+            right[col] = 0;
+            down[col] = 0;
+        }
+        // Coin flips are taken 64 at a time from one random word (kept in a local, the char stores below could
+        // alias anything in memory)
+        uint64_t flips = 0;
+        int32_t a = find_set(set, 0); // Set of the cell on the left, carried over from the previous step
+        for (node_t col = 0; col + 1 < width; col++) {
+            if ((col & 63) == 0) flips = gen();
+            int32_t b = find_set(set, col + 1);
+            bool flip = (flips >> (col & 63)) & 1;
+            right[col] = (a != b) & (closing_row | flip);
+            set[b] = right[col] ? a : b;
+            a = right[col] ? a : b;
+        }
+
+        if (!closing_row) {
+            // The sets don't change anymore in this row, point every column straight at its set
+            for (node_t col = 0; col < width; col++) {
+                set[col] = find_set(set, col);
+            }
+
+            // Vertical links: random ones first, then one forced link at a random member of every set that got none
+            for (node_t col = 0; col < width; col++) {
+                members[col] = 0;
+                has_down[col] = 0;
+                chosen[col] = -1;
+            }
+            for (node_t col = 0; col < width; col++) {
+                if ((col & 63) == 0) flips = gen();
+                int32_t s = set[col];
+                members[s]++;
+                down[col] = !last_row && ((flips >> (col & 63)) & 1); // An open last row only gets the forced links
+                has_down[s] |= down[col];
+            }
+            for (node_t col = 0; col < width; col++) {
+                int32_t s = set[col];
+                if (!has_down[s]) {
+                    if (chosen[s] < 0) chosen[s] = ((gen() >> 32) * members[s]) >> 32; // Uniform in [0, members) without a division
+                    if (chosen[s]-- == 0) {
+                        down[col] = 1;
+                        has_down[s] = 1;
+                    }
+                }
+            }
+
+            // Sets of the next row
+            for (node_t col = 0; col < width; col++) {
+                first_below[set[col]] = -1;
+            }
+            for (node_t col = 0; col < width; col++) {
+                next_set[col] = col;
+                if (down[col]) {
+                    int32_t s = set[col];
+                    if (first_below[s] == -1) first_below[s] = col;
+                    next_set[col] = first_below[s];
+                }
+            }
+            set.swap(next_set);
+        }
+
+        sink(row, right, down);
+    }
+}
+
+// Function to generate a maze using Eller's algorithm
+// @param grid: The topology of the graph (see grid.hpp)
+// @param maze: The cells of the graph (see cells.hpp), uses the tree edges
+// The algorithm is sequential, it runs on rank 0 which is the one expanding the tree into the maze
+template <class GridT, class Cells>
+void generateTreeUsingEller(const GridT& grid, Cells& maze, MPI_Comm comm, uint64_t seed) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if (rank != 0)
+        return;
+
+    std::mt19937_64 gen(random_at(seed, RNG_STREAM_ELLER, 0));
+    generateRowsUsingEller(grid.width(), grid.height(), gen, [&](node_t row, const std::vector<char>& right, const std::vector<char>& down) {
+        for (node_t col = 0; col < grid.width(); col++) {
+            node_t node = grid.node(row, col);
+            if (right[col]) maze.connect(node, grid.node(row, col + 1), RIGHT);
+            if (down[col]) maze.connect(node, grid.node(row + 1, col), DOWN);
+        }
+    });
+}
+
+#define INSTANTIATE_ELLER(GridT, Cells) template void generateTreeUsingEller<GridT, Cells>(const GridT& grid, Cells& maze, MPI_Comm comm, uint64_t seed);
+FOR_EACH_GRAPH_TYPE(INSTANTIATE_ELLER)
@@ -0,0 +1,17 @@
+#include <mpi.h>
+#include <vector>
+#include <random>
+#include <functional>
+#include "defs.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
+
+// Receives one finished row of the tree: right[j] / down[j] are 1 if node (row, j) is linked to its right / down neighbour
+typedef std::function<void(node_t row, const std::vector<char>& right, const std::vector<char>& down)> EllerRowSink;
+
+// Eller's algorithm: build a spanning tree of a width x height grid graph one row at a time with O(width) state
+// close = false leaves the last row open, with exactly one down link per set, for another block of rows below
+void generateRowsUsingEller(node_t width, node_t height, std::mt19937_64& gen, const EllerRowSink& sink, bool close = true);
+
+template <class GridT, class Cells>
+void generateTreeUsingEller(const GridT& grid, Cells& maze, MPI_Comm comm, uint64_t seed);
@@ -1,229 +1,233 @@
 #include <mpi.h>
-#include <algorithm>
+#include <omp.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
 #include <vector>
-#include <unordered_set>
-#include <random>
 #include "defs.hpp"
 #include "kruskal.hpp"
-
-// Union-Find data structure
-std::vector<int> parent; //Stores the parent of each node in the tree (the disjoint set) -> //! Is it possible to not use this and do something more optmized with the graph structure we currently have (i.e. using our macros?)
-std::vector<int> tree_height; // Stores the rank of each node in the tree (NOTE: This is not the process rank of mpi, rank here denotes the height of the tree rooted at the node) -> //! Is it possible to not use this and do something more optmized with the graph structure we currently have (i.e. using our macros?
-
-// Find the root of a node (with path compression) -> works by recursively finding the parent of the node and then setting the parent of the node to the root
-int find(int x) {
-    if (parent[x] == x) return x;
-    return parent[x] = find(parent[x]);
+#include "unionfind.hpp"
+#include "rng.hpp"
+
+// Kruskal's algorithm over the implicit edge list of the grid
+// - Every undirected edge is seen once, as the RIGHT / DOWN edge of its first node (grid.for_each_edge), and named by
+//   its edge id 2 * node + (1 if DOWN), so it never has to be stored as a pair of nodes
+// - Edge weights are 8 bits (GET_EDGE_WEIGHT: max of the two node weights), so the edges are ordered with a counting
+//   sort over KRUSKAL_BUCKETS buckets: one pass to count, one pass to place the edge ids. Linear time, and the edges of
+//   a bucket keep the walk order, which breaks the ties. The walk is row-major whatever the layout (not the storage
+//   order of for_each_edge), so -l rows and -l tiled give the same tree, as with -g boruvka
+// - Memory: 4 bytes per edge id (2 edges per node) + 4 bytes per node of union-find, ~12 bytes per node in all
+// - The tree is built on rank 0, which is the one expanding it into the maze
+// - With several OpenMP threads (-t) the edges of a bucket are taken by all threads at once through a lock-free
+//   union-find (ConcurrentUnionFind). The tree is still a minimum spanning tree, but which of two edges of equal
+//   weight makes it depends on the thread timing, so it is no longer a function of the seed alone
+
+#define KRUSKAL_BUCKETS 256
+#define KRUSKAL_SPILL_IDS (1 << 14) // Edge ids buffered per bucket file before a write (64 KB, 16 MB for all buckets)
+
+// Every undirected edge once as the RIGHT / DOWN edge of its first node, in row-major order of that node
+template <class GridT, class F>
+static void for_each_edge_row_major(const GridT& grid, F f) {
+    node_t w = grid.width(), h = grid.height();
+    for (node_t row = 0; row < h; row++) {
+        for (node_t col = 0; col < w; col++) {
+            node_t node = grid.node(row, col);
+            if (col < w - 1) f(node, grid.step(node, RIGHT), RIGHT);
+            if (row < h - 1) f(node, grid.step(node, DOWN), DOWN);
+        }
+    }
 }
 
-// Union two sets -> 
-/* For disjoint sets, we can merge two sets by making the root of one set the child of the root of the other set. 
-- This is done by comparing the heights of the trees rooted at the two sets. 
-- If the heights are equal, we can make one the child of the other and increment the height of the root. 
-- If the height of one is less than the other, we can make the root of the shorter tree the child of the root of the taller tree. 
-- If the height of one is greater than the other, we can make the root of the taller tree the child of the root of the shorter tree.
-*/
-void merge(int x, int y) {
-    int xroot = find(x);
-    int yroot = find(y);
-    if (xroot == yroot) return;
-    if (tree_height[xroot] < tree_height[yroot]) {
-        parent[xroot] = yroot;
-    } else if (tree_height[xroot] > tree_height[yroot]) {
-        parent[yroot] = xroot;
-    } else {
-        parent[yroot] = xroot;
-        tree_height[xroot]++;
+// The edge ids of the grid ordered by weight, bucket_start[b] is the first one of weight b
+template <class GridT, class Cells>
+static std::vector<uint32_t> sort_edges(const GridT& grid, const Cells& maze, std::vector<uint32_t>& bucket_start) {
+    auto edge_weight = [&](node_t node, node_t neighbour) { return std::max(maze.weight(node), maze.weight(neighbour)); };
+
+    bucket_start.assign(KRUSKAL_BUCKETS + 1, 0);
+    for_each_edge_row_major(grid, [&](node_t node, node_t neighbour, int dir) {
+        bucket_start[edge_weight(node, neighbour) + 1]++;
+    });
+    for (int b = 0; b < KRUSKAL_BUCKETS; b++) {
+        bucket_start[b + 1] += bucket_start[b];
     }
+    std::vector<uint32_t> next(bucket_start.begin(), bucket_start.end() - 1);
+    std::vector<uint32_t> sorted(bucket_start[KRUSKAL_BUCKETS]);
+    for_each_edge_row_major(grid, [&](node_t node, node_t neighbour, int dir) {
+        sorted[next[edge_weight(node, neighbour)]++] = 2 * node + (dir == DOWN);
+    });
+    return sorted;
 }
 
-// Generating the Tree using the Kruskal Algorithm
-void generateTreeUsingKruskal(int size, short *maze, MPI_Comm comm) {
-    int rank, commSize;
-    MPI_Comm_rank(comm, &rank);
-    MPI_Comm_size(comm, &commSize);
-
-    // Initialize parent and tree_height vectors - only in process 0
-    int n = size * size;
-    if (rank == 0) {
-        parent.resize(n);
-        tree_height.resize(n);
-        for (int i = 0; i < n; i++) {
-            parent[i] = i; // Initially, each node is the root of its own tree (i.e. each of them are its own disjoint set)
-            tree_height[i] = 0; // Hence the height of each tree is 0
+// Take the edges in order while they join two trees, until the tree spans the grid
+template <class GridT, class Cells>
+static void kruskal_sequential(const GridT& grid, Cells& maze, const std::vector<uint32_t>& sorted) {
+    FlatUnionFind sets(grid.cells());
+    node_t tree_edges = 0;
+    node_t needed = grid.width() * grid.height() - 1;
+    for (size_t i = 0; i < sorted.size() && tree_edges < needed; i++) {
+        node_t node = sorted[i] >> 1;
+        int dir = (sorted[i] & 1) ? DOWN : RIGHT;
+        node_t neighbour = grid.step(node, dir);
+        if (sets.unite(node, neighbour)) {
+            maze.connect(node, neighbour, dir);
+            tree_edges++;
         }
     }
-    else{
-        parent.resize(n);
-        tree_height.resize(n);
-    }
-
-    // Braodcast parent and tree_height to all processes
-    MPI_Bcast(parent.data(), n, MPI_INT, 0, comm);
-    MPI_Bcast(tree_height.data(), n, MPI_INT, 0, comm);
+}
 
-    // Create a list of edges (node pairs) and their weights
-    std::vector<std::tuple<int, int, int>> edges; // This is local to each process -> contains the edges that are connected to the nodes in the process 
-    //TODO: The above edges vector could probably be somehow replaced by our already exisiting graph sturcture -> the top 8 bits out of the 16 bits represents the "weight" of a node
-    
-    // Set the local edges 
-    for (int i = 0; i < n; i++) {
-        int node = maze[i];
-        int neighbour_node;
-        if ((neighbour_node = LEFT_NODE(i, size)) != -1) {
-            // printf("Rank: %d, Node: %d, Neighbour: %d\n", rank, i, neighbour_node);
-            int weight = GET_EDGE_WEIGHT(node, neighbour_node);
-            edges.emplace_back(i, neighbour_node, weight);
-        }
-        if ((neighbour_node = RIGHT_NODE(i,size)) != -1) {
-            // printf("Rank: %d, Node: %d, Neighbour: %d\n", rank, i, neighbour_node);
-            int weight = GET_EDGE_WEIGHT(node, neighbour_node);
-            edges.emplace_back(i, neighbour_node, weight);
-        }
-        if ((neighbour_node = UP_NODE(i, size)) != -1) {
-            // printf("Rank: %d, Node: %d, Neighbour: %d\n", rank, i, neighbour_node);
-            int weight =  GET_EDGE_WEIGHT(node, neighbour_node);
-            edges.emplace_back(i, neighbour_node, weight);
-        }
-        if ((neighbour_node = DOWN_NODE(i, size)) != -1) {
-            // printf("Rank: %d, Node: %d, Neighbour: %d\n", rank, i, neighbour_node);
-            int weight =  GET_EDGE_WEIGHT(node, neighbour_node);
-            edges.emplace_back(i, neighbour_node, weight);
+// Same, one bucket at a time with all threads on it
+// - An edge is rejected by the find()s of unite() as soon as its ends are joined, so the heavy edges are filtered out
+//   by lookups, and the buckets after the one completing the tree are never touched
+// - connect() writes the cells of both ends, so the accepted edges are left in sorted (rejected ones overwritten
+//   with NO_EDGE) and connected by one thread afterwards
+template <class GridT, class Cells>
+static void kruskal_parallel(const GridT& grid, Cells& maze, std::vector<uint32_t>& sorted, const std::vector<uint32_t>& bucket_start) {
+    const uint32_t NO_EDGE = UINT32_MAX;
+    ConcurrentUnionFind sets(grid.cells());
+    node_t tree_edges = 0;
+    node_t needed = grid.width() * grid.height() - 1;
+    size_t taken = 0;
+    for (int b = 0; b < KRUSKAL_BUCKETS && tree_edges < needed; b++) {
+        long long joined = 0;
+        #pragma omp parallel for schedule(dynamic, 4096) reduction(+:joined)
+        for (uint32_t i = bucket_start[b]; i < bucket_start[b + 1]; i++) {
+            node_t node = sorted[i] >> 1;
+            node_t neighbour = grid.step(node, (sorted[i] & 1) ? DOWN : RIGHT);
+            if (sets.unite(node, neighbour)) {
+                joined++;
+            } else {
+                sorted[i] = NO_EDGE;
+            }
         }
+        tree_edges += joined;
+        taken = bucket_start[b + 1];
     }
 
-    // if (rank == 0) {
-    //     // print edges
-    //     printf("Edges:\n");
-    //     for (auto edge : edges) {
-    //         int u = std::get<0>(edge);
-    //         int v = std::get<1>(edge);
-    //         int w = std::get<2>(edge);
-    //         fprintf(stderr, "Edge: %d %d %d\n", u, v, w);
-    //     }
-    // }
-    //? The below code could be optimized parallelly
-    // Sort local edges by weight
-    std::sort(edges.begin(), edges.end(), [](const auto &a, const auto &b) {
-        return std::get<2>(a) < std::get<2>(b);
-    });
-
-    // Scatter edges to all processes
-    int edgeCount = edges.size(); // Total number of edges in current process
-    int *edgeBuffer = nullptr; // Buffer to store all the edges in rank 0
-    if (rank == 0) {
-        edgeBuffer = new int[edgeCount * 3];
-        for (int i = 0; i < edgeCount; i++) {
-            edgeBuffer[i * 3] = std::get<0>(edges[i]);
-            edgeBuffer[i * 3 + 1] = std::get<1>(edges[i]);
-            edgeBuffer[i * 3 + 2] = std::get<2>(edges[i]);
-        }
+    for (size_t i = 0; i < taken; i++) {
+        if (sorted[i] == NO_EDGE) continue;
+        node_t node = sorted[i] >> 1;
+        int dir = (sorted[i] & 1) ? DOWN : RIGHT;
+        maze.connect(node, grid.step(node, dir), dir);
     }
+}
 
-    int *localEdges = nullptr;
-    int localEdgeCount;
-    if (rank == 0) {
-        localEdgeCount = edgeCount;
-        localEdges = edgeBuffer;
+// Generating the Tree using the Kruskal Algorithm
+template <class GridT, class Cells>
+void generateTreeUsingKruskal(const GridT& grid, Cells& maze, MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if (rank != 0)
+        return;
+
+    std::vector<uint32_t> bucket_start;
+    std::vector<uint32_t> sorted = sort_edges(grid, maze, bucket_start);
+    if (omp_get_max_threads() > 1) {
+        kruskal_parallel(grid, maze, sorted, bucket_start);
     } else {
-        localEdgeCount = (edgeCount / commSize) * 3;
-        int remainder = (edgeCount % commSize) * 3;
-        if (rank < remainder) {
-            localEdgeCount += 3;
-        }
-        localEdges = new int[localEdgeCount];
+        kruskal_sequential(grid, maze, sorted);
     }
+}
 
-    int *rcvCounts = new int[commSize]; // Number of elements to receive from each process
-    int *disps = new int[commSize]; // Displacements for scatterv
-    for (int i = 0; i < commSize; i++) { // Compute the number of elements to receive from each process
-        rcvCounts[i] = (edgeCount / commSize) * 3; // Each edge has 3 elements
-        if (i < (edgeCount % commSize)) { // If there are any remaining edges
-            rcvCounts[i] += 3; // add 3 more elements
+// Semi-external version: the counting sort becomes a distribution of the edge ids into one file per weight
+// - Pass 1 walks the graph row by row, with the weights of two rows in memory, and appends every edge id to the file of
+//   its weight. Walking in id order keeps each bucket sorted by id, the tie order of the in-memory version
+// - Pass 2 reads the buckets back in weight order, a block at a time, until the tree spans the graph
+// - Both passes are sequential I/O, the only random accesses are the union-find's
+bool generateTreeUsingExternalKruskal(node_t graph_width, node_t graph_height, uint64_t seed, const char* scratch_path, BitplaneCells& tree, KruskalIOStats* stats){
+    double t0 = MPI_Wtime();
+    std::vector<FILE*> buckets(KRUSKAL_BUCKETS, nullptr);
+    bool failed = false;
+    for (int b = 0; b < KRUSKAL_BUCKETS && !failed; b++){
+        std::vector<char> name(strlen(scratch_path) + 16);
+        snprintf(name.data(), name.size(), "%s.bucket%03d", scratch_path, b);
+        buckets[b] = fopen(name.data(), "w+b");
+        if (buckets[b] == nullptr){
+            fprintf(stderr, "Error: Cannot create scratch file '%s': %s\n", name.data(), strerror(errno));
+            failed = true;
+        } else {
+            unlink(name.data()); // Gone with the last close, even if we crash
         }
     }
 
-    disps[0] = 0; // Displacement for the first process
-    for (int i = 1; i < commSize; i++) {  // Compute the displacements for scatterv
-        disps[i] = disps[i - 1] + rcvCounts[i - 1]; // Displacement for the current process is the sum of the number of elements received from all previous processes
+    // Pass 1: distribute the edge ids
+    long long written = 0;
+    std::vector<std::vector<uint32_t>> spill(KRUSKAL_BUCKETS);
+    auto flush = [&](int b) {
+        failed = failed || fwrite(spill[b].data(), sizeof(uint32_t), spill[b].size(), buckets[b]) != spill[b].size();
+        written += spill[b].size() * sizeof(uint32_t);
+        spill[b].clear();
+    };
+    std::vector<uint8_t> weights[2] = {std::vector<uint8_t>(graph_width), std::vector<uint8_t>(graph_width)};
+    auto load_row = [&](node_t row, std::vector<uint8_t>& out) {
+        for_each_weight(seed, row * graph_width, (row + 1) * graph_width, [&](node_t index, int weight) {
+            out[index - row * graph_width] = weight;
+        });
+    };
+    if (!failed){
+        load_row(0, weights[0]);
     }
-
-    MPI_Scatterv(edgeBuffer, rcvCounts, disps, MPI_INT, localEdges, localEdgeCount, MPI_INT, 0, comm); // Scatter the edges to all processes
-
-    delete[] rcvCounts;
-    delete[] disps;
-
-    MPI_Barrier(comm);
-
-    // Kruskal's algorithm (parallel)
-    std::unordered_set<int> mstNodes; // Stores the nodes in the MST
-    for (int i = 0; i < localEdgeCount; i += 3) { // Iterate over the local edges
-        int u = localEdges[i]; // Get the first node of the edge
-        int v = localEdges[i + 1]; // Get the second node of the edge
-        if (find(u) != find(v)) { // If the nodes are not in the same set
-            merge(u, v); // Merge the sets
-            mstNodes.insert(u); // Add the nodes to the MST
-            mstNodes.insert(v);
+    for (node_t row = 0; row < graph_height && !failed; row++){
+        std::vector<uint8_t>& here = weights[row & 1];
+        std::vector<uint8_t>& below = weights[(row + 1) & 1];
+        if (row + 1 < graph_height){
+            load_row(row + 1, below);
         }
-    }
-
-    // Gather MST nodes from all processes
-    std::vector<int> localMstNodes(mstNodes.begin(), mstNodes.end()); // Convert the set to a vector
-    int localMstNodesSize = localMstNodes.size(); // Get the size of the local MST nodes
-
-    // Gather the sizes of localMstNodes from all processes
-    std::vector<int> mstNodesSizes(commSize); // Stores the sizes of MST nodes from all processes
-    MPI_Gather(&localMstNodesSize, 1, MPI_INT, mstNodesSizes.data(), 1, MPI_INT, 0, comm); // Gather the sizes of localMstNodes from all processes
-
-    // Compute the total size of mstNodes
-    int totalMstNodesSize = 0;
-    if (rank == 0) {
-        for (int size : mstNodesSizes) { // Compute the total size of mstNodes
-            totalMstNodesSize += size; // Add the size of each process
+        for (node_t col = 0; col < graph_width; col++){
+            uint32_t id = 2 * (row * graph_width + col);
+            auto add = [&](int weight, uint32_t edge) {
+                spill[weight].push_back(edge);
+                if (spill[weight].size() == KRUSKAL_SPILL_IDS) flush(weight);
+            };
+            if (col < graph_width - 1) add(std::max(here[col], here[col + 1]), id);
+            if (row < graph_height - 1) add(std::max(here[col], below[col]), id + 1);
         }
     }
-
-    // Broadcast the total size to all processes
-    MPI_Bcast(&totalMstNodesSize, 1, MPI_INT, 0, comm); // Broadcast the total size of mstNodes to all processes
-
-    // Resize the localMstNodes vector to the total size and gather the data
-    std::vector<int> gatheredMstNodes(totalMstNodesSize);
-    int *recvBuffer = gatheredMstNodes.data(); // Buffer to store the gathered MST nodes
-    int *recvCounts = mstNodesSizes.data(); // Number of elements to receive from each process
-    int *displs = new int[commSize]; // Displacements for gatherv
-    int disp = 0;
-    for (int i = 0; i < commSize; i++) {
-        displs[i] = disp; // Compute the displacements for gatherv
-        disp += recvCounts[i]; // Displacement for the current process is the sum of the number of elements received from all previous processes
+    for (int b = 0; b < KRUSKAL_BUCKETS && !failed; b++){
+        flush(b);
+        failed = failed || fflush(buckets[b]) != 0;
     }
-
-    MPI_Gatherv(localMstNodes.data(), localMstNodesSize, MPI_INT,
-                recvBuffer, recvCounts, displs, MPI_INT, 0, comm); // Gather the MST nodes from all processes
-
-    delete[] displs;
-
-    // Update the maze with the MST nodes (rank 0)
-    if (rank == 0) {
-       for (int i = 0; i < n; i++){
-        if (RIGHT_NODE(i,size) != -1 && mstNodes.find(i) != mstNodes.end() && mstNodes.find(RIGHT_NODE(i,size)) != mstNodes.end()){
-            SET_RIGHT(maze[i]);
-            SET_LEFT(maze[RIGHT_NODE(i,size)]);
-        }
-        if (DOWN_NODE(i,size) != -1 && mstNodes.find(i) != mstNodes.end() && mstNodes.find(DOWN_NODE(i,size)) != mstNodes.end()){
-            SET_DOWN(maze[i]);
-            SET_UP(maze[DOWN_NODE(i,size)]);
+    std::vector<std::vector<uint32_t>>().swap(spill);
+    double t1 = MPI_Wtime();
+
+    // Pass 2: join the trees in weight order
+    long long read = 0;
+    FlatUnionFind sets(graph_width * graph_height);
+    node_t tree_edges = 0;
+    node_t needed = graph_width * graph_height - 1;
+    std::vector<uint32_t> block(KRUSKAL_SPILL_IDS);
+    for (int b = 0; b < KRUSKAL_BUCKETS && tree_edges < needed && !failed; b++){
+        rewind(buckets[b]);
+        size_t count;
+        while (tree_edges < needed && (count = fread(block.data(), sizeof(uint32_t), block.size(), buckets[b])) > 0){
+            read += count * sizeof(uint32_t);
+            for (size_t i = 0; i < count && tree_edges < needed; i++){
+                node_t node = block[i] >> 1;
+                int dir = (block[i] & 1) ? DOWN : RIGHT;
+                node_t neighbour = dir == DOWN ? node + graph_width : node + 1;
+                if (sets.unite(node, neighbour)){
+                    tree.connect(node, neighbour, dir);
+                    tree_edges++;
+                }
+            }
         }
-       }
+        failed = failed || ferror(buckets[b]);
     }
-
-    if (rank != 0) {
-        delete[] localEdges;
-    } else {
-        delete[] edgeBuffer;
+    for (FILE* bucket : buckets){
+        if (bucket != nullptr) fclose(bucket);
+    }
+    if (failed){
+        fprintf(stderr, "Error: Reading / writing the Kruskal scratch files failed\n");
     }
 
-    // Showcase the tree generated
-    if (rank == 0) {
-        print_maze_visual(maze, size);
+    if (stats != nullptr){
+        stats->bucket_bytes_written = written;
+        stats->bucket_bytes_read = read;
+        stats->distribute_s = t1 - t0;
+        stats->join_s = MPI_Wtime() - t1;
     }
-}
\ No newline at end of file
+    return !failed;
+}
+
+#define INSTANTIATE_KRUSKAL(GridT, Cells) template void generateTreeUsingKruskal<GridT, Cells>(const GridT& grid, Cells& maze, MPI_Comm comm);
+FOR_EACH_GRAPH_TYPE(INSTANTIATE_KRUSKAL)
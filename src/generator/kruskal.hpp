@@ -1,3 +1,21 @@
 #include <mpi.h>
 #include "defs.hpp"
-void generateTreeUsingKruskal(int size, short *maze, MPI_Comm comm);
\ No newline at end of file
+#include "cells.hpp"
+#include "grid.hpp"
+template <class GridT, class Cells>
+void generateTreeUsingKruskal(const GridT& grid, Cells& maze, MPI_Comm comm);
+
+// I/O of the external memory Kruskal (--stream)
+struct KruskalIOStats {
+    long long bucket_bytes_written; // Edge ids spilled to the bucket files
+    long long bucket_bytes_read; // Edge ids read back until the tree was complete
+    double distribute_s; // Computing the weights and spilling the edge ids
+    double join_s; // Reading the buckets back and joining the trees
+};
+
+// Minimum spanning tree of a graph_width x graph_height graph without its edge list in memory (semi-external Kruskal)
+// - Same weights (from seed, see init_graph) and tie order as generateTreeUsingKruskal, so the same tree
+// - The edge ids go to one scratch file per weight (scratch_path.bucketNNN, unlinked as soon as they are created), the
+//   union-find is the only per-node state in RAM (4 bytes per node)
+// - The tree edges are set in tree (row-major node ids, needs PLANE_LINKS), returns false if a scratch file failed
+bool generateTreeUsingExternalKruskal(node_t graph_width, node_t graph_height, uint64_t seed, const char* scratch_path, BitplaneCells& tree, KruskalIOStats* stats = nullptr);
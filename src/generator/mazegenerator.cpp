@@ -2,8 +2,12 @@
 #include <stdio.h>
 #include <string.h>
 #include <random>
+#include <algorithm>
 
 #include "mazegenerator.hpp"
+#include "mpiutils.hpp"
+#include "mazefile.hpp"
+#include "rng.hpp"
 
 /* Basic Implementation Idea
 ^ - According to assignment instructions, we have to assign each cell in 64x64 maze as either "wall" cell or "non-wall" cell
@@ -35,134 +39,245 @@ So basically we'll
 */
 
 //! Possibly need to include weights -> would have to change macro's and the way we store edges
-short* init_graph(int size){
-    // create random weight for node
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(1, 255); // since we have 8 bits for weight
-    short* edges = (short*)malloc(size * size * sizeof(short));
-    for (int i = 0; i < size * size; i++){
-        edges[i] = 0x00; // Nothing is set, (But while doing bfs/kruskal we'll assume fully connected i.e. we wont be using the GET_LEFT, GET_RIGHT, etc. macros)
-        SET_NODE_WEIGHT(edges[i], dis(gen)); // Set the weight of the node
+// Set a random weight on every node of the graph (the cells start out with nothing else set)
+// (But while doing bfs/kruskal we'll assume fully connected i.e. we wont be using the connected_right / connected_down accessors)
+// The weight of a node only depends on the seed and its row-major id (see rng.hpp), so every rank computes the same
+// weights on its own (split over its threads) and the layout of the grid doesn't change them
+template <class GridT, class Cells>
+void init_graph(const GridT& graph, Cells& edges, uint64_t seed){
+    #pragma omp parallel for schedule(static)
+    for (node_t row = 0; row < graph.height(); row++){
+        node_t first = row * graph.width();
+        for_each_weight(seed, first, first + graph.width(), [&](node_t index, int weight) {
+            edges.set_weight(graph.node(row, index - first), weight); // 8 bits for weight
+        });
     }
-    return edges;
 }
 
 // Initialize the maze with all walls
-void init_maze(int size, short* maze){
-    // create random weight for node
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(1, 255); // since we have 8 bits for weight
-    // short* maze = (short*)malloc(size * size * sizeof(short));
-    for (int i = 0; i < size * size; i++){
-        maze[i] = 0x00; // All walls (i.e. no connections at all)
-    }
-    // return maze;
-
-}
+// Nothing to do: freshly constructed cells have every bit (including C) cleared, i.e. all walls
 
-
-void expand_edges_to_maze(int size, short* edges, short* maze){
-    // Now we need to convert the edges to the maze
+// Expand row i of the tree into the maze rows 2i and 2i+1, calling set_c(row, col) for every C cell (the rest are walls)
+// links(j, right, down) gives the tree edges of node (i, j)
+// Everything the expansion adds (wall column, last row, path to the exit) only depends on the row it is in,
+// so a maze can be expanded (and written out) one tree row at a time
+template <class Links, class SetC>
+void expand_tree_row(int i, int width, int height, Links links, SetC set_c){
     // Every (i, j) in the edges should be converted to (2*i, 2*j + 1) in the maze and should be made as C
     // if there is a connection between say (i, j) and (i, j+1) then (2*i, 2*j+2) should be made as C 
     // else if there is a connection between say (i, j) and (i+1, j) then (2*i+1, 2*j+1) should be made as C
-    // Then just make the intial column as W's and last row as W's and finally add a path to (63, 0) from (62, 1) through (63, 1) or (62, 0) depending on the C bit of (62, 1) or (63, 0)
+    // Then just make the intial column as W's and last row as W's and finally add a path to (h-1, 0) from (h-2, 1) through (h-1, 1) or (h-2, 0) depending on the C bit of (h-2, 1) or (h-1, 0)
+    int graph_width = (width + 1) / 2;
+    int row = 2 * i;
+    for (int j = 0; j < graph_width; j++){
+        bool right, down;
+        links(j, right, down);
+        set_c(row, 2 * j + 1); // The node itself
+        if (right){
+            set_c(row, 2 * j + 2); // The right neighbour
+        }
+        if (down && row + 1 < height - 1){
+            set_c(row + 1, 2 * j + 1); // The down neighbour (the last row is replaced below)
+        }
+    }
+
+    // We need to add a new column at the beginning and a new row at the end (it seems like they want top right of the maze to be the entry and bottom left to be the exit)
+    // with alternating C's in first column from (0,0) to (h-3,0) since (h-2,0) can't be C by construction
+    // (rows 2i are even and 2i+1 odd, so only row 2i can get one)
+    if (row < height - 2){
+        set_c(row, 0);
+    }
+
+    if (row + 1 == height - 1){
+        // But we need a path from (h-2, 1) to (h-1, 0)
+        // We can just make (h-1, 1) or (h-2, 0) as C, (h-2, 1) is node (i, 0) of the tree so it is always C -> (h-1, 1)
+        // The cell (h-1, 0) should be by default C
+        set_c(height - 1, 0);
+        set_c(height - 1, 1);
+        // Optionally add more complexity by adding alternate C and W cells in the last row
+        // Note that for last row the alternating C should be from the very last cell of that row (h-1, w-1) to the (h-1, 3) since (h-1, 0) and (h-1, 1) are C by construction
+        for (int col = 3; col < width - 1; col += 2){
+            set_c(height - 1, col);
+        }
+    }
+}
+
+template <class GridT, class Cells>
+void expand_edges_to_maze(const GridT& grid, Cells& edges, Cells& maze){
+    // Now we need to convert the edges to the maze, one row of the tree at a time (see expand_tree_row)
     // We should also change the corresponding edge bit values in the maze
-    int edges_size = (size + 1) / 2;
-    for (int i = 0; i < edges_size; i++){
-        for (int j = 0; j < edges_size; j++){
-            int node_edges_ind = i * edges_size + j; // index in the edges array
-            int node_maze_ind = 2 * i * size + 2 * j + 1; // index in the maze array
-            maze[node_maze_ind] = edges[node_edges_ind]; // Every edge that was there in spanning tree is also there in the maze
-            SET_C(maze[node_maze_ind]); // Set the C bit in maze array for the node
-            if (GET_RIGHT(edges[node_edges_ind])){
-                SET_C(maze[node_maze_ind + 1]); // Set the C bit in maze array for the right neighbour
-            }
-            if (GET_DOWN(edges[i * edges_size + j])){
-                SET_C(maze[node_maze_ind + size]); // Set the C bit in maze array for the down neighbour
+    int width = grid.width();
+    int height = grid.height();
+    typename GridT::Half graph = grid.half();
+    for (int i = 0; i < graph.height(); i++){
+        expand_tree_row(i, width, height, [&](int j, bool& right, bool& down) {
+            node_t node_edges_ind = graph.node(i, j); // index in the edges array
+            right = edges.connected_right(node_edges_ind);
+            down = edges.connected_down(node_edges_ind);
+        }, [&](int row, int col) {
+            maze.set_c(grid.node(row, col));
+        });
+        if (maze.has_weights() && edges.has_weights()){
+            for (int j = 0; j < graph.width(); j++){
+                maze.set_weight(grid.node(2 * i, 2 * j + 1), edges.weight(graph.node(i, j))); // Keep the weight of the node for the solvers
             }
         }
     }
+}
 
-    // We need to add a new row at the end and a new column at the beginning (it seems like they want top right of the maze to be the entry and bottom left to be the exit)
-    for (int i = 0; i < size; i++){
-        maze[size * (size - 1) + i] = 0x00; // Add a new row at the end
-        // Set all the column 0 cells to be walls
-        maze[size * i] = 0x00; // Essentially adding a new column at the beginning
+// Writes a maze to a file one tree row at a time (expand_tree_row), only the two maze rows of the tree row in memory
+class MazeRowStreamer {
+public:
+    MazeRowStreamer(int width, int height) : width(width), height(height) {
+        size_t row_words = (width + 63) / 64;
+        rows[0].assign(row_words, 0);
+        rows[1].assign(row_words, 0);
     }
 
-    // But we need a path from (62, 1) to (63, 0)
-    // We can just make (63, 1) or (62, 0) as C
-    if (IS_C(maze[size * (size - 2) + 1])){
-        SET_C(maze[size * (size - 1) + 1]);
-    } else {
-        SET_C(maze[size * (size - 2)]);
+    // Create the file (rows layout), false on error
+    bool open(const char* path, const char* generator, uint64_t seed){
+        MazeFileHeader header = {};
+        header.layout = MAZE_LAYOUT_ROWS;
+        header.width = width;
+        header.height = height;
+        header.seed = seed;
+        header.cells = (node_t)width * height;
+        strncpy(header.generator, generator, MAX_ARG_LEN - 1);
+        return writer.open(path, header);
     }
 
-    // The cell (63, 0) should be by default C
-    SET_C(maze[size * (size - 1)]);
-
-    // Optionally add more complexity by adding alternate C and W cells in the last row and column
-    // Note that for last row the alternating C should be from the very last cell of that row (size-1, size-1) to the (size-1, 3) since (size-1, 0) and (size-1, 1) are C by construction
-    for (int i = 3; i < size - 1; i++){
-        if (i % 2 == 1){
-            SET_C(maze[size * (size - 1) + i]);
+    // Expand and write tree row i, links(j, right, down) as for expand_tree_row (rows must come in order)
+    template <class Links>
+    void write_tree_row(int i, Links links){
+        expand_tree_row(i, width, height, links, [&](int row, int col) {
+            rows[row & 1][col >> 6] |= (uint64_t)1 << (col & 63);
+        });
+        for (int k = 0; k < 2; k++){
+            writer.write_bits(rows[k].data(), width);
+            std::fill(rows[k].begin(), rows[k].end(), 0);
         }
     }
 
-    // Similarly we have to add alternating C's in first column from (0,0) to (61,o) since (62,0) can't be C by construction
-    for (int i = 0; i < size - 2; i++){
-        if (i % 2 == 0){
-            SET_C(maze[size * i]);
-        }
+    bool close(){ return writer.close(); }
+
+private:
+    int width, height;
+    std::vector<uint64_t> rows[2];
+    MazeFileWriter writer;
+};
+
+bool stream_maze_using_eller(int width, int height, const char* path, uint64_t seed){
+    // Only two maze rows (one tree row) are ever in memory, they go to the file as soon as they are expanded
+    MazeRowStreamer streamer(width, height);
+    if (!streamer.open(path, "eller", seed)){
+        return false;
+    }
+    std::mt19937_64 gen(random_at(seed, RNG_STREAM_ELLER, 0));
+    generateRowsUsingEller((width + 1) / 2, (height + 1) / 2, gen, [&](node_t i, const std::vector<char>& right, const std::vector<char>& down) {
+        streamer.write_tree_row(i, [&](int j, bool& r, bool& d) {
+            r = right[j];
+            d = down[j];
+        });
+    });
+    return streamer.close();
+}
+
+bool stream_maze_using_kruskal(int width, int height, const char* path, uint64_t seed, KruskalIOStats* stats){
+    // The tree is built first (its edge list goes through scratch files next to the maze file), then written out
+    // row by row: in memory are the union-find (4 bytes per node) and the tree edges (2 bits per node)
+    node_t graph_width = (width + 1) / 2;
+    node_t graph_height = (height + 1) / 2;
+    BitplaneCells tree(graph_width * graph_height, PLANE_LINKS);
+    if (!generateTreeUsingExternalKruskal(graph_width, graph_height, seed, path, tree, stats)){
+        return false;
+    }
+    MazeRowStreamer streamer(width, height);
+    if (!streamer.open(path, "kruskal", seed)){
+        return false;
+    }
+    for (node_t i = 0; i < graph_height; i++){
+        streamer.write_tree_row(i, [&](int j, bool& r, bool& d) {
+            r = tree.connected_right(i * graph_width + j);
+            d = tree.connected_down(i * graph_width + j);
+        });
     }
+    return streamer.close();
 }
 
-short* generator_main(int size, char solving_algorithm[MAX_ARG_LEN], MPI_Comm comm){
+template <class Cells>
+Cells generator_slab(const Slab& slab, MPI_Comm comm, uint64_t seed){
+    // Every rank generates the rows of the tree under its own slab on its own (Eller's algorithm, see eller.cpp):
+    // the last row of every slab is left open, only the slab at the bottom of the maze closes it
+    // The down links of a slab's last tree row land in its own last maze row, so nothing has to be exchanged
+    // until the ghost rows are filled in
+    Cells maze(slab.grid().cells(), MAZE_PLANES);
+    int first_graph_row = slab.first_row / 2;
+    bool bottom = slab.first_row + slab.rows == slab.height;
+
+    std::mt19937_64 gen(random_at(seed, RNG_STREAM_ELLER, first_graph_row));
+    generateRowsUsingEller((slab.width + 1) / 2, slab.rows / 2, gen, [&](node_t i, const std::vector<char>& right, const std::vector<char>& down) {
+        expand_tree_row(first_graph_row + i, slab.width, slab.height, [&](int j, bool& r, bool& d) {
+            r = right[j];
+            d = down[j];
+        }, [&](int row, int col) {
+            maze.set_c(slab.node(row, col));
+        });
+    }, bottom);
+
+    exchange_halos(slab, maze, comm);
+    return maze;
+}
+
+template PackedCells generator_slab<PackedCells>(const Slab& slab, MPI_Comm comm, uint64_t seed);
+template BitplaneCells generator_slab<BitplaneCells>(const Slab& slab, MPI_Comm comm, uint64_t seed);
+
+template <class GridT, class Cells>
+Cells generator_main(const GridT& grid, char solving_algorithm[MAX_ARG_LEN], MPI_Comm comm, uint64_t seed, BFSStats* bfs_stats, bool bfs_direction_optimizing){
     int rank;
     MPI_Comm_rank(comm, &rank);
 
-    int graph_size = (size + 1) / 2; // The size of the graph (i.e. the number of nodes in the graph)
-    //! Cannot do the below now because of the random generation of weights -> This would cause each process to have different weights for the same nodes
-    // short* edges = init_graph(graph_size); // Generates the initial graph with all neighbours connected (shrinked graph) -> size + 1 for odd sizes
-    short* edges = (short*)malloc(graph_size * graph_size * sizeof(short));
+    // The graph (i.e. the nodes of the maze before expansion), (width+1)/2 x (height+1)/2
+    typename GridT::Half graph = grid.half();
+    bool needs_weights = strcmp(solving_algorithm, "kruskal") == 0 || strcmp(solving_algorithm, "boruvka") == 0;
+    Cells edges(graph.cells(), GRAPH_PLANES | (needs_weights ? PLANE_WEIGHT : 0));
 
-    // broadcast one initialized graph from rank 0 to all other processes
-    if (rank == 0){
-        edges = init_graph(graph_size);
+    // Every process computes the weights itself, they are the same everywhere as they only depend on the seed
+    if (needs_weights){
+        init_graph(graph, edges, seed);
     }
 
-    MPI_Bcast(edges, graph_size * graph_size, MPI_SHORT, 0, comm);
-
     if (strcmp(solving_algorithm, "bfs") == 0){
-        generateTreeUsingBFS(graph_size, edges, comm);
+        generateTreeUsingBFS(graph, edges, comm, seed, bfs_stats, bfs_direction_optimizing);
     } else if (strcmp(solving_algorithm, "kruskal") == 0){
-        generateTreeUsingKruskal(graph_size, edges, comm);
+        generateTreeUsingKruskal(graph, edges, comm);
+    } else if (strcmp(solving_algorithm, "eller") == 0){
+        generateTreeUsingEller(graph, edges, comm, seed);
+    } else if (strcmp(solving_algorithm, "boruvka") == 0){
+        generateTreeUsingBoruvka(graph, edges, comm);
     }
     else {
         printf("Invalid solving algorithm\n");
     }
 
     // edges now contain the (min) spanning tree
-    // Now we need to convert this to a 64x64 maze
-    // We can do this by initializing a 64x64 maze with all walls
-    // short* maze = (short*)malloc(size * size * sizeof(short));
-    short* const maze = new short[size * size];
+    // Now we need to convert this to a width x height maze
+    // We can do this by initializing a width x height maze with all walls
+    // The weights of a weighted graph are kept in the maze, they are the cell costs of the weighted solvers
+    unsigned maze_weights = needs_weights ? PLANE_WEIGHT : 0;
+    Cells maze(grid.cells(), MAZE_PLANES | maze_weights);
     if (rank == 0){
-        init_maze(size, maze);
-        // print_edges(edges, (size + 1) / 2); // For debugging purposes
-        expand_edges_to_maze(size, edges, maze);
+        // print_edges(edges.data(), graph.width(), graph.height()); // For debugging purposes
+        expand_edges_to_maze(grid, edges, maze);
         // printing the final obtained maze
-        // print_maze_complete(maze, size);
-        // free(maze);
+        // print_maze_complete(maze.data(), grid.width(), grid.height());
     } 
-    // Broadcast the maze to all processes
+    // Broadcast the maze to all processes (only the C/W bits and the weights are set at this point)
     // printf("Rank %d\n", rank);
-    MPI_Bcast(maze, size * size, MPI_SHORT, 0, comm);
+    bcast_cells(maze, PLANE_C | maze_weights, 0, comm);
     // printf("Rank %d\n", rank);
 
     return maze;
 }
 
+#define INSTANTIATE_GENERATOR(GridT, Cells) template Cells generator_main<GridT, Cells>(const GridT& grid, char solving_algorithm[MAX_ARG_LEN], MPI_Comm comm, uint64_t seed, BFSStats* bfs_stats, bool bfs_direction_optimizing);
+FOR_EACH_MAZE_TYPE(INSTANTIATE_GENERATOR)
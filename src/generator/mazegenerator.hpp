@@ -1,7 +1,26 @@
 #include "defs.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
 #include "bfs.hpp"
 #include "kruskal.hpp"
+#include "eller.hpp"
+#include "boruvka.hpp"
+#include "slab.hpp"
 //! Function prototypes for maze generation - NOT FINAL
-short* init_graph(int size);
-void init_maze(int size, short* maze);
-short* generator_main(int size, char solving_algorithm[MAX_ARG_LEN], MPI_Comm comm);
\ No newline at end of file
+// All the randomness is drawn from seed (see rng.hpp), the same seed gives the same maze whatever the number of ranks
+// -g bfs fills in bfs_stats if not null and goes bottom-up on the levels where that is cheaper if bfs_direction_optimizing
+template <class GridT, class Cells>
+Cells generator_main(const GridT& grid, char solving_algorithm[MAX_ARG_LEN], MPI_Comm comm, uint64_t seed, BFSStats* bfs_stats = nullptr, bool bfs_direction_optimizing = false);
+
+// Generate a width x height maze with Eller's algorithm straight into a maze file (rows layout), one row at a time
+// Memory is O(width) so the maze can be larger than RAM, returns false if writing the file failed
+bool stream_maze_using_eller(int width, int height, const char* path, uint64_t seed);
+
+// Same with Kruskal's algorithm (generateTreeUsingExternalKruskal): the edges go through scratch files next to path,
+// memory is ~4.25 bytes per tree node instead of the whole maze, stats gets the scratch I/O if not null
+bool stream_maze_using_kruskal(int width, int height, const char* path, uint64_t seed, KruskalIOStats* stats = nullptr);
+
+// Generate the slab of the maze owned by this rank (--slabs, only Eller's algorithm), ghost rows included
+// Every slab draws from its own stream, so the maze depends on the seed and on how the rows are split
+template <class Cells>
+Cells generator_slab(const Slab& slab, MPI_Comm comm, uint64_t seed);
\ No newline at end of file
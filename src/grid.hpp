@@ -0,0 +1,270 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <algorithm>
+
+#include "defs.hpp"
+#include "cells.hpp"
+
+// Grid topologies: map (row, col) to node ids and find the neighbours of a node
+// - The ROW/COL/..._NODE macros in defs.hpp do an integer division and a modulo for every neighbour,
+//   the types below compute the coordinates of a node at most once and use shifts / masks when the width is a power of 2
+// - Grid<W, H> has the dimensions baked in at compile time (the default 64x64 maze), Grid<> reads them at runtime
+//   and Pow2Grid is a runtime grid whose width is a power of 2
+// - TiledGrid stores the cells in small square tiles instead of rows (node ids are tiled storage indices)
+// - Every grid has a Half type / half() for the graph the generators work on ((width+1)/2 x (height+1)/2)
+// - The generators and solvers are templates over the grid type (and the cell type, see cells.hpp)
+
+#define DYNAMIC_DIM 0
+
+constexpr bool is_pow2(node_t x) { return x > 0 && (x & (x - 1)) == 0; }
+constexpr int log2_floor(node_t x) { return x <= 1 ? 0 : 1 + log2_floor(x / 2); }
+
+// Everything that only needs row()/col()/node() and the dimensions, shared by all the grids
+template <class Derived>
+class GridBase {
+public:
+    node_t left(node_t node) const { return self().col(node) > 0 ? self().step(node, LEFT) : -1; }
+    node_t right(node_t node) const { return self().col(node) < self().width() - 1 ? self().step(node, RIGHT) : -1; }
+    node_t up(node_t node) const { return self().row(node) > 0 ? self().step(node, UP) : -1; }
+    node_t down(node_t node) const { return self().row(node) < self().height() - 1 ? self().step(node, DOWN) : -1; }
+
+    // Neighbour in a direction (the caller makes sure it exists)
+    node_t step(node_t node, int dir) const {
+        switch (dir) {
+            case LEFT: return node - 1;
+            case RIGHT: return node + 1;
+            case UP: return node - self().width();
+            default: return node + self().width();
+        }
+    }
+
+    // Border-aware neighbour iterator: calls f(neighbour, dir) for the neighbours inside the grid in the order
+    // LEFT, RIGHT, UP, DOWN (same order the algorithms used with the macros), the coordinates are computed once
+    // for all 4 of them. Stops early (and returns true) as soon as f returns true
+    template <class F>
+    bool for_each_neighbour(node_t node, F f) const {
+        node_t row = self().row(node);
+        node_t col = node - row * self().width();
+        if (col > 0 && f(node - 1, LEFT)) return true;
+        if (col < self().width() - 1 && f(node + 1, RIGHT)) return true;
+        if (row > 0 && f(node - self().width(), UP)) return true;
+        if (row < self().height() - 1 && f(node + self().width(), DOWN)) return true;
+        return false;
+    }
+
+    // Walk the grid row by row calling f(node, row, col), node ids are advanced instead of recomputed
+    template <class F>
+    void for_each_cell(F f) const {
+        node_t node = 0;
+        for (node_t row = 0; row < self().height(); row++) {
+            for (node_t col = 0; col < self().width(); col++, node++) {
+                f(node, row, col);
+            }
+        }
+    }
+
+    // Walk every undirected edge once (as the RIGHT / DOWN edge of its first node) calling f(node, neighbour, dir)
+    // The borders are known from the loop bounds so no coordinates are computed
+    template <class F>
+    void for_each_edge(F f) const {
+        node_t w = self().width();
+        node_t h = self().height();
+        node_t node = 0;
+        for (node_t row = 0; row < h; row++) {
+            for (node_t col = 0; col < w; col++, node++) {
+                if (col < w - 1) f(node, node + 1, RIGHT);
+                if (row < h - 1) f(node, node + w, DOWN);
+            }
+        }
+    }
+
+    node_t node(node_t row, node_t col) const { return row * self().width() + col; }
+    node_t cells() const { return self().width() * self().height(); }
+
+private:
+    const Derived& self() const { return static_cast<const Derived&>(*this); }
+};
+
+// Grid with compile time dimensions, or runtime ones when W / H are DYNAMIC_DIM
+template <node_t W = DYNAMIC_DIM, node_t H = DYNAMIC_DIM>
+class Grid : public GridBase<Grid<W, H>> {
+public:
+    typedef Grid<(W == DYNAMIC_DIM ? DYNAMIC_DIM : (W + 1) / 2), (H == DYNAMIC_DIM ? DYNAMIC_DIM : (H + 1) / 2)> Half;
+
+    Grid(int width, int height) : w(W == DYNAMIC_DIM ? width : W), h(H == DYNAMIC_DIM ? height : H) {}
+
+    node_t width() const {
+        if constexpr (W != DYNAMIC_DIM) return W;
+        else return w;
+    }
+    node_t height() const {
+        if constexpr (H != DYNAMIC_DIM) return H;
+        else return h;
+    }
+    node_t row(node_t node) const {
+        if constexpr (W != DYNAMIC_DIM && is_pow2(W)) return node >> log2_floor(W);
+        else return node / width();
+    }
+    node_t col(node_t node) const {
+        if constexpr (W != DYNAMIC_DIM && is_pow2(W)) return node & (W - 1);
+        else return node % width();
+    }
+
+    Half half() const { return Half((width() + 1) / 2, (height() + 1) / 2); }
+
+private:
+    node_t w, h;
+};
+
+// Runtime grid with a power of 2 width: rows and columns are a shift and a mask away
+class Pow2Grid : public GridBase<Pow2Grid> {
+public:
+    typedef Pow2Grid Half;
+
+    Pow2Grid(int width, int height) : w(width), h(height), shift(log2_floor(width)), mask(width - 1) {}
+
+    node_t width() const { return w; }
+    node_t height() const { return h; }
+    node_t row(node_t node) const { return node >> shift; }
+    node_t col(node_t node) const { return node & mask; }
+
+    node_t node(node_t row, node_t col) const { return (row << shift) | col; }
+
+    Half half() const { return Half((w + 1) / 2, (h + 1) / 2); }
+
+private:
+    node_t w, h;
+    int shift;
+    node_t mask;
+};
+
+// Cache-blocked layout: the grid is cut into TILE_DIM x TILE_DIM tiles stored one after the other (row-major inside
+// a tile, tiles in row-major order), so that a vertical step stays in the same tile 7 times out of 8 instead of
+// jumping a whole row of the maze. A tile is 64 cells, i.e. one word of a BitplaneCells bit plane / 2 cache lines
+// of PackedCells
+// - The last tile row / column is padded, cells() is the number of node ids (the size of the storage), the padding
+//   cells are never handed out by node() / for_each_cell() / for_each_neighbour() so the algorithms never see them
+// - for_each_cell() / for_each_edge() walk the cells in storage order (tile by tile)
+#define TILE_SHIFT 3
+#define TILE_DIM (1 << TILE_SHIFT)
+#define TILE_MASK (TILE_DIM - 1)
+#define TILE_CELLS (TILE_DIM * TILE_DIM)
+
+class TiledGrid : public GridBase<TiledGrid> {
+public:
+    typedef TiledGrid Half;
+
+    TiledGrid(int width, int height) : w(width), h(height), tiles_x((width + TILE_MASK) >> TILE_SHIFT),
+        tiles_y((height + TILE_MASK) >> TILE_SHIFT), tile_row_cells(tiles_x * TILE_CELLS) {}
+
+    node_t width() const { return w; }
+    node_t height() const { return h; }
+    node_t cells() const { return tiles_x * tiles_y * TILE_CELLS; }
+
+    node_t row(node_t node) const { return ((node >> (2 * TILE_SHIFT)) / tiles_x << TILE_SHIFT) | ((node >> TILE_SHIFT) & TILE_MASK); }
+    node_t col(node_t node) const { return ((node >> (2 * TILE_SHIFT)) % tiles_x << TILE_SHIFT) | (node & TILE_MASK); }
+    node_t node(node_t row, node_t col) const {
+        node_t tile = (row >> TILE_SHIFT) * tiles_x + (col >> TILE_SHIFT);
+        return (tile << (2 * TILE_SHIFT)) | ((row & TILE_MASK) << TILE_SHIFT) | (col & TILE_MASK);
+    }
+
+    // Stepping out of a tile lands on the opposite edge of the neighbouring tile
+    node_t step(node_t node, int dir) const {
+        node_t in_col = node & TILE_MASK;
+        node_t in_row = (node >> TILE_SHIFT) & TILE_MASK;
+        switch (dir) {
+            case LEFT: return in_col > 0 ? node - 1 : node - TILE_CELLS + TILE_MASK;
+            case RIGHT: return in_col < TILE_MASK ? node + 1 : node + TILE_CELLS - TILE_MASK;
+            case UP: return in_row > 0 ? node - TILE_DIM : node - tile_row_cells + TILE_MASK * TILE_DIM;
+            default: return in_row < TILE_MASK ? node + TILE_DIM : node + tile_row_cells - TILE_MASK * TILE_DIM;
+        }
+    }
+
+    // Same contract as GridBase::for_each_neighbour (LEFT, RIGHT, UP, DOWN, stops when f returns true)
+    template <class F>
+    bool for_each_neighbour(node_t node, F f) const {
+        node_t tile = node >> (2 * TILE_SHIFT);
+        node_t tile_row = tile / tiles_x;
+        node_t in_row = (node >> TILE_SHIFT) & TILE_MASK;
+        node_t in_col = node & TILE_MASK;
+        node_t row = (tile_row << TILE_SHIFT) | in_row;
+        node_t col = ((tile - tile_row * tiles_x) << TILE_SHIFT) | in_col;
+        if (col > 0 && f(in_col > 0 ? node - 1 : node - TILE_CELLS + TILE_MASK, LEFT)) return true;
+        if (col < w - 1 && f(in_col < TILE_MASK ? node + 1 : node + TILE_CELLS - TILE_MASK, RIGHT)) return true;
+        if (row > 0 && f(in_row > 0 ? node - TILE_DIM : node - tile_row_cells + TILE_MASK * TILE_DIM, UP)) return true;
+        if (row < h - 1 && f(in_row < TILE_MASK ? node + TILE_DIM : node + tile_row_cells - TILE_MASK * TILE_DIM, DOWN)) return true;
+        return false;
+    }
+
+    // Walk the cells tile by tile (storage order) calling f(node, row, col), skipping the padding
+    template <class F>
+    void for_each_cell(F f) const {
+        for (node_t tile_row = 0; tile_row < tiles_y; tile_row++) {
+            for (node_t tile_col = 0; tile_col < tiles_x; tile_col++) {
+                node_t node = (tile_row * tiles_x + tile_col) << (2 * TILE_SHIFT);
+                node_t row0 = tile_row << TILE_SHIFT;
+                node_t col0 = tile_col << TILE_SHIFT;
+                node_t rows = std::min<node_t>(TILE_DIM, h - row0);
+                node_t cols = std::min<node_t>(TILE_DIM, w - col0);
+                for (node_t r = 0; r < rows; r++) {
+                    for (node_t c = 0; c < cols; c++) {
+                        f(node + (r << TILE_SHIFT) + c, row0 + r, col0 + c);
+                    }
+                }
+            }
+        }
+    }
+
+    // Every undirected edge once as the RIGHT / DOWN edge of its first node, in storage order
+    template <class F>
+    void for_each_edge(F f) const {
+        for_each_cell([&](node_t node, node_t row, node_t col) {
+            if (col < w - 1) f(node, (col & TILE_MASK) < TILE_MASK ? node + 1 : node + TILE_CELLS - TILE_MASK, RIGHT);
+            if (row < h - 1) f(node, (row & TILE_MASK) < TILE_MASK ? node + TILE_DIM : node + tile_row_cells - TILE_MASK * TILE_DIM, DOWN);
+        });
+    }
+
+    Half half() const { return Half((w + 1) / 2, (h + 1) / 2); }
+
+private:
+    node_t w, h;
+    node_t tiles_x, tiles_y;
+    node_t tile_row_cells; // Node ids between a cell and the same cell one tile row further down
+};
+
+typedef Grid<DEFAULT_MAZE_DIM, DEFAULT_MAZE_DIM> DefaultGrid; // The 64x64 maze of the assignment
+typedef Grid<> DynamicGrid;
+
+// Follow the parent directions the solvers keep in the cells (see cells.hpp) from node towards stop, calling f on every
+// node it leaves while keep(node) holds. Returns where it stopped: stop, or the first node keep rejected
+template <class GridT, class Cells, class Keep, class F>
+inline node_t walk_parents(const GridT& grid, const Cells& cells, node_t node, node_t stop, Keep keep, F f) {
+    while (node != stop && keep(node)) {
+        f(node);
+        node = grid.step(node, cells.parent_dir(node));
+    }
+    return node;
+}
+template <class GridT, class Cells, class F>
+inline node_t walk_parents(const GridT& grid, const Cells& cells, node_t node, node_t stop, F f) {
+    return walk_parents(grid, cells, node, stop, [](node_t) { return true; }, f);
+}
+
+// Explicit instantiation lists: X(grid, cells) for every combination the program is built for
+// Maze grids are what solvers / generator_main see, graph grids are their Half types used by the tree generators
+#define FOR_EACH_GRID_TYPE(X) X(DefaultGrid) X(Pow2Grid) X(DynamicGrid) X(TiledGrid)
+
+#define FOR_EACH_MAZE_TYPE(X) \
+    X(DefaultGrid, PackedCells) X(DefaultGrid, BitplaneCells) \
+    X(Pow2Grid, PackedCells) X(Pow2Grid, BitplaneCells) \
+    X(DynamicGrid, PackedCells) X(DynamicGrid, BitplaneCells) \
+    X(TiledGrid, PackedCells) X(TiledGrid, BitplaneCells)
+
+#define FOR_EACH_GRAPH_TYPE(X) \
+    X(DefaultGrid::Half, PackedCells) X(DefaultGrid::Half, BitplaneCells) \
+    X(Pow2Grid, PackedCells) X(Pow2Grid, BitplaneCells) \
+    X(DynamicGrid, PackedCells) X(DynamicGrid, BitplaneCells) \
+    X(TiledGrid, PackedCells) X(TiledGrid, BitplaneCells)
+
+#endif // GRID_H
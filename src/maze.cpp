@@ -4,15 +4,199 @@
 #include <ctype.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <omp.h>
+#include <random>
 
 #include "defs.hpp"
+#include "mpiutils.hpp"
+#include "grid.hpp"
+#include "mazefile.hpp"
+#include "queryfile.hpp"
+#include "mazeprint.hpp"
 #include "mazegenerator.hpp"
 #include "mazesolver.hpp"
+#include "slab.hpp"
+#include "slabbfs.hpp"
+#include "batch.hpp"
 
-bool parse_inputs(int argc, char* argv[], char* generation_algorithm, char* solving_algorithm) {
+// Options that are not the generation / solving algorithm
+struct Options {
+    int width = DEFAULT_MAZE_DIM;
+    int height = DEFAULT_MAZE_DIM;
+    bool quiet = false; // Don't print the final maze (for large runs)
+    bool stats = false; // Print timings and peak memory per rank to stderr
+    bool bitplanes = false; // Store the cells as bitplanes (BitplaneCells) instead of one short per cell (PackedCells)
+    bool tiled = false; // Store the cells in 8x8 tiles (TiledGrid) instead of row by row
+    char save_path[MAX_PATH_LEN] = ""; // Save the generated maze to this file (see mazefile.hpp)
+    char load_path[MAX_PATH_LEN] = ""; // Load the maze from this file instead of generating one
+    int format = OUTPUT_ASCII; // How the final maze is printed (see mazeprint.hpp)
+    bool stream = false; // Generate with Eller's / external Kruskal straight into the save_path file, one row at a time
+    bool slabs = false; // Every rank only holds a slab of rows of the maze (see slab.hpp)
+    int threads = 1; // OpenMP threads per rank (hybrid mode, used by the BFS generator)
+    bool bfs_direction_optimizing = false; // Let the BFS generator go bottom-up on its last levels (see bfs.cpp)
+    int delta = DIJKSTRA_DEFAULT_DELTA; // Bucket width of the delta-stepping solver (-s dijkstra), f window of -s astar on several ranks
+    char queries_path[MAX_PATH_LEN] = ""; // Answer the start / end pairs of this file instead of solving the maze (see queryfile.hpp)
+    char answers_path[MAX_PATH_LEN] = "-"; // Where the answers of the queries go
+    int answer_format = ANSWERS_CSV;
+    bool has_seed = false;
+    uint64_t seed = 0; // All the randomness of the generators comes from it (see rng.hpp), drawn by rank 0 if not given
+};
+
+// Parse a maze dimension, returns false if it is not a valid even number in [MIN_MAZE_DIM, MAX_MAZE_DIM]
+bool parse_dim(const char* flag, const char* value, int* dim) {
+    char* end;
+    long v = strtol(value, &end, 10);
+    if (*end != '\0' || v < MIN_MAZE_DIM || v > MAX_MAZE_DIM || v % 2 != 0) {
+        fprintf(stderr, "Error: %s expects an even number between %d and %d, got '%s'\n", flag, MIN_MAZE_DIM, MAX_MAZE_DIM, value);
+        return false;
+    }
+    *dim = (int)v;
+    return true;
+}
+
+bool parse_inputs(int argc, char* argv[], char* generation_algorithm, char* solving_algorithm, Options* opts) {
     for (int i = 1; i < argc; ++i) {
         char* arg = argv[i];
-        if (strcmp(arg, "-g") == 0) {
+        if (strcmp(arg, "-n") == 0 || strcmp(arg, "-w") == 0 || strcmp(arg, "-h") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: Missing argument for %s\n", arg);
+                return false;
+            }
+            int dim;
+            if (!parse_dim(arg, argv[++i], &dim)) {
+                return false;
+            }
+            if (arg[1] != 'h') opts->width = dim;
+            if (arg[1] != 'w') opts->height = dim;
+        } else if (strcmp(arg, "-r") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: Missing argument for -r\n");
+                return false;
+            }
+            char* representation = argv[++i];
+            if (strcmp(representation, "bitplane") == 0) {
+                opts->bitplanes = true;
+            } else if (strcmp(representation, "packed") == 0) {
+                opts->bitplanes = false;
+            } else {
+                fprintf(stderr, "Error: Invalid cell representation '%s'\n", representation);
+                return false;
+            }
+        } else if (strcmp(arg, "-l") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: Missing argument for -l\n");
+                return false;
+            }
+            char* layout = argv[++i];
+            if (strcmp(layout, "tiled") == 0) {
+                opts->tiled = true;
+            } else if (strcmp(layout, "rows") == 0) {
+                opts->tiled = false;
+            } else {
+                fprintf(stderr, "Error: Invalid cell layout '%s'\n", layout);
+                return false;
+            }
+        } else if (strcmp(arg, "-f") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: Missing argument for -f\n");
+                return false;
+            }
+            char* format = argv[++i];
+            if (strcmp(format, "ascii") == 0) {
+                opts->format = OUTPUT_ASCII;
+            } else if (strcmp(format, "pbm") == 0) {
+                opts->format = OUTPUT_PBM;
+            } else if (strcmp(format, "pgm") == 0) {
+                opts->format = OUTPUT_PGM;
+            } else {
+                fprintf(stderr, "Error: Invalid output format '%s'\n", format);
+                return false;
+            }
+        } else if (strcmp(arg, "-o") == 0 || strcmp(arg, "-i") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: Missing argument for %s\n", arg);
+                return false;
+            }
+            if (strlen(argv[i + 1]) >= MAX_PATH_LEN) {
+                fprintf(stderr, "Error: Path for %s is longer than %d characters\n", arg, MAX_PATH_LEN - 1);
+                return false;
+            }
+            strcpy(arg[1] == 'o' ? opts->save_path : opts->load_path, argv[++i]);
+        } else if (strcmp(arg, "--queries") == 0 || strcmp(arg, "--answers") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: Missing argument for %s\n", arg);
+                return false;
+            }
+            if (strlen(argv[i + 1]) >= MAX_PATH_LEN) {
+                fprintf(stderr, "Error: Path for %s is longer than %d characters\n", arg, MAX_PATH_LEN - 1);
+                return false;
+            }
+            strcpy(arg[2] == 'q' ? opts->queries_path : opts->answers_path, argv[++i]);
+        } else if (strcmp(arg, "--answer-format") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: Missing argument for --answer-format\n");
+                return false;
+            }
+            char* format = argv[++i];
+            if (strcmp(format, "csv") == 0) {
+                opts->answer_format = ANSWERS_CSV;
+            } else if (strcmp(format, "bin") == 0) {
+                opts->answer_format = ANSWERS_BINARY;
+            } else {
+                fprintf(stderr, "Error: Invalid answer format '%s'\n", format);
+                return false;
+            }
+        } else if (strcmp(arg, "-t") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: Missing argument for -t\n");
+                return false;
+            }
+            char* end;
+            long threads = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || threads < 1 || threads > MAX_THREADS) {
+                fprintf(stderr, "Error: -t expects a number of threads between 1 and %d, got '%s'\n", MAX_THREADS, argv[i]);
+                return false;
+            }
+            opts->threads = (int)threads;
+        } else if (strcmp(arg, "--delta") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: Missing argument for --delta\n");
+                return false;
+            }
+            char* end;
+            long delta = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || delta < 1 || delta > MAX_DELTA) {
+                fprintf(stderr, "Error: --delta expects a bucket width between 1 and %d, got '%s'\n", MAX_DELTA, argv[i]);
+                return false;
+            }
+            opts->delta = (int)delta;
+        } else if (strcmp(arg, "--seed") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: Missing argument for --seed\n");
+                return false;
+            }
+            char* end;
+            errno = 0;
+            unsigned long long seed = strtoull(argv[++i], &end, 0);
+            if (*end != '\0' || errno != 0 || argv[i][0] == '-') {
+                fprintf(stderr, "Error: --seed expects an unsigned 64-bit number, got '%s'\n", argv[i]);
+                return false;
+            }
+            opts->seed = seed;
+            opts->has_seed = true;
+        } else if (strcmp(arg, "-q") == 0) {
+            opts->quiet = true;
+        } else if (strcmp(arg, "--stats") == 0) {
+            opts->stats = true;
+        } else if (strcmp(arg, "--stream") == 0) {
+            opts->stream = true;
+        } else if (strcmp(arg, "--slabs") == 0) {
+            opts->slabs = true;
+        } else if (strcmp(arg, "--bfs-dir-opt") == 0) {
+            opts->bfs_direction_optimizing = true;
+        } else if (strcmp(arg, "-g") == 0) {
             if (i + 1 < argc) {
                 strcpy(generation_algorithm, argv[++i]);
                 for (char* c = generation_algorithm; *c; ++c) {
@@ -38,17 +222,49 @@ bool parse_inputs(int argc, char* argv[], char* generation_algorithm, char* solv
         }
     }
 
-    if (strlen(generation_algorithm) == 0 || strlen(solving_algorithm) == 0) {
+    // Modes: generate and solve (-g, -s), generate and save (-g, -o, -s optional), load and solve (-i, -s)
+    bool load = strlen(opts->load_path) > 0;
+    bool save = strlen(opts->save_path) > 0;
+    if (load && (save || strlen(generation_algorithm) > 0)) {
+        fprintf(stderr, "Error: -i cannot be combined with -g or -o\n");
+        return false;
+    }
+    if ((!load && strlen(generation_algorithm) == 0) || (!save && strlen(solving_algorithm) == 0)) {
         fprintf(stderr, "Error: Missing required arguments\n");
         return false;
     }
 
-    if (strcmp(generation_algorithm, "bfs") != 0 && strcmp(generation_algorithm, "kruskal") != 0) {
+    if (!load && strcmp(generation_algorithm, "bfs") != 0 && strcmp(generation_algorithm, "kruskal") != 0 && strcmp(generation_algorithm, "eller") != 0 && strcmp(generation_algorithm, "boruvka") != 0) {
         fprintf(stderr, "Error: Invalid generation algorithm '%s'\n", generation_algorithm);
         return false;
     }
 
-    if (strcmp(solving_algorithm, "dfs") != 0 && strcmp(solving_algorithm, "dijkstra") != 0) {
+    if (opts->bfs_direction_optimizing && strcmp(generation_algorithm, "bfs") != 0) {
+        fprintf(stderr, "Error: --bfs-dir-opt needs -g bfs\n");
+        return false;
+    }
+
+    // Streaming never holds the maze, so it can only be written to a file (in rows layout)
+    bool streamable = strcmp(generation_algorithm, "eller") == 0 || strcmp(generation_algorithm, "kruskal") == 0;
+    if (opts->stream && (!streamable || !save || strlen(solving_algorithm) > 0 || opts->tiled)) {
+        fprintf(stderr, "Error: --stream needs -g eller or -g kruskal and -o, and works without -s and -l tiled\n");
+        return false;
+    }
+
+    // Slabs are generated row by row and solved with the slab BFS, the maze is never whole on any rank
+    if (opts->slabs && (strcmp(generation_algorithm, "eller") != 0 || strcmp(solving_algorithm, "bfs") != 0 || save || opts->tiled || opts->stream)) {
+        fprintf(stderr, "Error: --slabs needs -g eller and -s bfs, and works without -o, -i, -l tiled and --stream\n");
+        return false;
+    }
+
+    // Batches answer distances with the tree index, a BFS per start or the junction graph, on the whole maze
+    bool batch = strlen(opts->queries_path) > 0;
+    if (batch && ((strcmp(solving_algorithm, "lca") != 0 && strcmp(solving_algorithm, "bfs") != 0 && strcmp(solving_algorithm, "junction") != 0) || opts->slabs || opts->stream)) {
+        fprintf(stderr, "Error: --queries needs -s lca, -s bfs or -s junction, and works without --slabs and --stream\n");
+        return false;
+    }
+
+    if (strlen(solving_algorithm) > 0 && !batch && strcmp(solving_algorithm, "dfs") != 0 && strcmp(solving_algorithm, "wsdfs") != 0 && strcmp(solving_algorithm, "dijkstra") != 0 && strcmp(solving_algorithm, "astar") != 0 && strcmp(solving_algorithm, "bibfs") != 0 && strcmp(solving_algorithm, "lca") != 0 && strcmp(solving_algorithm, "junction") != 0 && !(opts->slabs && strcmp(solving_algorithm, "bfs") == 0)) {
         fprintf(stderr, "Error: Invalid solving algorithm '%s'\n", solving_algorithm);
         return false;
     }
@@ -56,73 +272,300 @@ bool parse_inputs(int argc, char* argv[], char* generation_algorithm, char* solv
     return true;
 }
 
-void print_maze_final(short* edges, int size, int start, int end){
-    for (int i = 0; i < size; i++){
-        for (int j = 0; j < size; j++){
-            int node = NODE(i, j, size);
-            if (IS_W(edges[node])){
-                // a) * for wall cells in the maze,
-                printf("*");
-            } else if (node == start){
-                // (d) S for the entry cell
-                printf("S");
-            } else if (node == end){
-                // (e) E for the exit cell
-                printf("E");
-            } else if (IS_P(edges[node])){
-                // (c) P for non-wall cells in the maze in solution path,
-                printf("P");
-            } else if (IS_C(edges[node])){
-                // (b) space for non-wall cells in the maze not in solution path,
-                printf(" ");
-            } else {
-                printf("?");
+// Cells the solver visited on this rank (its VISITED_SOLVE bits): pushed for dfs, settled for dijkstra, closed for astar
+template <class Cells>
+double count_visited_solve(const Cells& maze) {
+    node_t visited = 0;
+    for (node_t node = 0; node < maze.count(); node++) {
+        visited += maze.is_visited_solve(node);
+    }
+    return (double)visited;
+}
+
+// Gather a per-rank value on rank 0 and print it as one line (used for --stats)
+void report_per_rank(const char* label, double value, MPI_Comm comm, int decimals = 3) {
+    int rank, commSize;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &commSize);
+    double* values = (double*)malloc(commSize * sizeof(double));
+    MPI_Gather(&value, 1, MPI_DOUBLE, values, 1, MPI_DOUBLE, 0, comm);
+    if (rank == 0) {
+        fprintf(stderr, "%s", label);
+        for (int i = 0; i < commSize; i++) {
+            fprintf(stderr, " %.*f", decimals, values[i]);
+        }
+        fprintf(stderr, "\n");
+    }
+    free(values);
+}
+
+// Answer the queries of opts.queries_path on the maze (--queries), rank 0 writes the answers; returns the query count
+template <class GridT, class Cells>
+node_t run_queries(const Options& opts, const GridT& grid, const Cells& maze, char* solving_algorithm, node_t root, MPI_Comm comm, BatchStats* stats) {
+    int my_rank;
+    MPI_Comm_rank(comm, &my_rank);
+
+    // Rank 0 reads the queries (they may come from stdin) and hands them to everyone
+    std::vector<Query> queries;
+    node_t count = 0;
+    if (my_rank == 0) {
+        if (!read_queries(opts.queries_path, (int)grid.width(), (int)grid.height(), queries)) {
+            MPI_Abort(comm, 1);
+        }
+        count = queries.size();
+    }
+    MPI_Bcast(&count, 1, MPI_NODE_T, 0, comm);
+    queries.resize(count);
+    bcast_chunked(queries.data(), count * sizeof(Query), MPI_BYTE, 0, comm); // Query is plain data
+
+    std::vector<node_t> starts(count), ends(count), distances;
+    for (node_t i = 0; i < count; i++) {
+        starts[i] = grid.node(queries[i].start_row, queries[i].start_col);
+        ends[i] = grid.node(queries[i].end_row, queries[i].end_col);
+    }
+    solve_queries(grid, maze, solving_algorithm, comm, root, starts, ends, distances, stats);
+
+    if (my_rank == 0 && !write_answers(opts.answers_path, queries, distances, opts.answer_format)) {
+        MPI_Abort(comm, 1);
+    }
+    return count;
+}
+
+// Generate (or load), solve and print the maze with the given grid topology and cell storage
+template <class GridT, class Cells>
+void run_maze(const Options& opts, char* generation_algorithm, char* solving_algorithm, const MazeFile* file, MPI_Comm comm) {
+    int my_rank, commSize;
+    MPI_Comm_rank(comm, &my_rank);
+    MPI_Comm_size(comm, &commSize);
+
+    int width = opts.width;
+    int height = opts.height;
+    GridT grid(width, height);
+    node_t start = grid.node(0, width-1);
+    node_t end = grid.node(height-1, 0);
+
+    if (file != nullptr && (node_t)file->header().cells != grid.cells()) {
+        if (my_rank == 0)
+            fprintf(stderr, "Error: Maze file holds %llu cells, expected %lld for %dx%d\n", (unsigned long long)file->header().cells, (long long)grid.cells(), width, height);
+        MPI_Abort(comm, 1);
+    }
+
+    // Generate the maze, or map it from the file
+    double t0 = MPI_Wtime();
+    BFSStats bfs_stats;
+    Cells maze = file != nullptr ? load_maze<Cells>(*file)
+                                 : generator_main<GridT, Cells>(grid, generation_algorithm, comm, opts.seed, opts.stats ? &bfs_stats : nullptr, opts.bfs_direction_optimizing);
+    double t1 = MPI_Wtime();
+    // printf("Maze generated\n");
+    // if (my_rank == 0)
+        // print_maze_complete(maze.data(), width, height);
+
+    if (strlen(opts.save_path) > 0 && my_rank == 0) {
+        MazeFileHeader header = {};
+        header.layout = opts.tiled ? MAZE_LAYOUT_TILED : MAZE_LAYOUT_ROWS;
+        header.width = width;
+        header.height = height;
+        header.seed = opts.seed;
+        strncpy(header.generator, generation_algorithm, MAX_ARG_LEN - 1);
+        if (!save_maze(opts.save_path, maze, header)) {
+            MPI_Abort(comm, 1);
+        }
+    }
+
+    double t2 = MPI_Wtime();
+    bool batch = strlen(opts.queries_path) > 0;
+    BatchStats batch_stats = {};
+    node_t query_count = 0;
+    if (batch)
+        query_count = run_queries(opts, grid, maze, solving_algorithm, start, comm, &batch_stats);
+    else if (strlen(solving_algorithm) > 0)
+        solver_main(grid, maze, solving_algorithm, comm, start, end, opts.delta);
+    double t3 = MPI_Wtime();
+    // printf("Maze solved\n");
+
+    MPI_Barrier(comm);
+
+    if (opts.stats) {
+        if (my_rank == 0)
+            fprintf(stderr, "maze %dx%d gen=%s seed=%llu solve=%s cells=%s layout=%s ranks=%d threads=%d delta=%d\n", width, height, file != nullptr ? file->header().generator : generation_algorithm, (unsigned long long)(file != nullptr ? file->header().seed : opts.seed), solving_algorithm, opts.bitplanes ? "bitplane" : "packed", opts.tiled ? "tiled" : "rows", commSize, opts.threads, opts.delta);
+        report_per_rank(file != nullptr ? "load_s" : "generate_s", t1 - t0, comm);
+        if (file == nullptr && strcmp(generation_algorithm, "bfs") == 0) {
+            // The levels and switches are the same on every rank, the edge checks are each rank's share
+            if (my_rank == 0) {
+                fprintf(stderr, "bfs_levels %d bottom_up_levels %d switch_levels", bfs_stats.levels, bfs_stats.bottom_up_levels);
+                for (int level : bfs_stats.switch_levels) fprintf(stderr, " %d", level);
+                fprintf(stderr, "\n");
+            }
+            report_per_rank("bfs_exchange_s", bfs_stats.exchange_s, comm);
+            report_per_rank("bfs_edge_checks", (double)bfs_stats.edge_checks, comm, 0);
+            if (opts.bfs_direction_optimizing) {
+                report_per_rank("bfs_bottom_up_checks", (double)bfs_stats.bottom_up_checks, comm, 0);
+                report_per_rank("bfs_top_down_would_be", (double)bfs_stats.top_down_checks, comm, 0);
             }
         }
-        printf("\n");
+        if (strlen(opts.save_path) > 0)
+            report_per_rank("save_s", t2 - t1, comm);
+        if (batch) {
+            // Throughput over the slowest rank, the index build (prepare_s) is paid once per maze
+            double slowest;
+            MPI_Reduce(&batch_stats.query_s, &slowest, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+            report_per_rank("prepare_s", batch_stats.prepare_s, comm);
+            report_per_rank("query_s", batch_stats.query_s, comm);
+            if (my_rank == 0)
+                fprintf(stderr, "queries %lld queries_per_s %.0f\n", (long long)query_count, query_count / slowest);
+        } else {
+            report_per_rank("solve_s", t3 - t2, comm);
+            if (strlen(solving_algorithm) > 0)
+                report_per_rank("solve_visited", count_visited_solve(maze), comm, 0);
+        }
+        report_per_rank("peak_rss_mb", peak_rss_kb() / 1024.0, comm);
+    }
+
+    if (my_rank == 0 && !opts.quiet && !batch) {
+        // a) * for wall cells in the maze, (b) space for non-wall cells in the maze not in solution path,
+        // (c) P for non-wall cells in the maze in solution path, (d) S for the entry cell, (e) E for the exit cell
+        if (!write_maze(stdout, grid, maze, start, end, opts.format)) {
+            fprintf(stderr, "Error: Writing the maze failed\n");
+        }
+    }
+}
+
+// Generate, solve and print the maze split in slabs of rows (--slabs), see slab.hpp
+template <class Cells>
+void run_slabs(const Options& opts, MPI_Comm comm) {
+    int my_rank, commSize;
+    MPI_Comm_rank(comm, &my_rank);
+    MPI_Comm_size(comm, &commSize);
+
+    // Every rank needs at least one row of the tree
+    if (commSize > opts.height / 2) {
+        if (my_rank == 0)
+            fprintf(stderr, "Error: --slabs needs at most %d ranks for a height of %d\n", opts.height / 2, opts.height);
+        MPI_Abort(comm, 1);
+    }
+
+    Slab slab(opts.width, opts.height, comm);
+
+    double t0 = MPI_Wtime();
+    Cells maze = generator_slab<Cells>(slab, comm, opts.seed);
+    double t1 = MPI_Wtime();
+    solveSlabUsingBFS(slab, maze, comm);
+    double t2 = MPI_Wtime();
+
+    MPI_Barrier(comm);
+
+    if (opts.stats) {
+        if (my_rank == 0)
+            fprintf(stderr, "maze %dx%d gen=eller seed=%llu solve=bfs cells=%s layout=slabs ranks=%d\n", opts.width, opts.height, (unsigned long long)opts.seed, opts.bitplanes ? "bitplane" : "packed", commSize);
+        report_per_rank("generate_s", t1 - t0, comm);
+        report_per_rank("solve_s", t2 - t1, comm);
+        report_per_rank("peak_rss_mb", peak_rss_kb() / 1024.0, comm);
+    }
+
+    if (!opts.quiet) {
+        if (!write_slab_maze(stdout, slab, maze, opts.format, comm) && my_rank == 0) {
+            fprintf(stderr, "Error: Writing the maze failed\n");
+        }
+    }
+}
+
+// Pick the tiled layout if asked for, else the most specialized grid topology for the dimensions (see grid.hpp)
+template <class Cells>
+void dispatch_grid(const Options& opts, char* generation_algorithm, char* solving_algorithm, const MazeFile* file, MPI_Comm comm) {
+    if (opts.tiled) {
+        run_maze<TiledGrid, Cells>(opts, generation_algorithm, solving_algorithm, file, comm);
+    } else if (opts.width == DEFAULT_MAZE_DIM && opts.height == DEFAULT_MAZE_DIM) {
+        run_maze<DefaultGrid, Cells>(opts, generation_algorithm, solving_algorithm, file, comm);
+    } else if (is_pow2(opts.width)) {
+        run_maze<Pow2Grid, Cells>(opts, generation_algorithm, solving_algorithm, file, comm);
+    } else {
+        run_maze<DynamicGrid, Cells>(opts, generation_algorithm, solving_algorithm, file, comm);
     }
 }
 
 int main(int argc, char* argv[]) {
-    MPI_Init(&argc, &argv);
+    // Only the master thread of a rank calls MPI, the OpenMP threads (-t) just expand frontiers
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 
-    int size = 64;
     int my_rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
 
-    char generation_algorithm[MAX_ARG_LEN];
-    char solving_algorithm[MAX_ARG_LEN];
+    char generation_algorithm[MAX_ARG_LEN] = "";
+    char solving_algorithm[MAX_ARG_LEN] = "";
+    Options opts;
 
     if (my_rank == 0) {
-        if (!parse_inputs(argc, argv, generation_algorithm, solving_algorithm)) {
+        if (!parse_inputs(argc, argv, generation_algorithm, solving_algorithm, &opts)) {
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
+        if (!opts.has_seed) {
+            std::random_device rd;
+            opts.seed = ((uint64_t)rd() << 32) | rd();
+        }
     }
 
     // Broadcast the parsed arguments to all processes
     MPI_Bcast(generation_algorithm, MAX_ARG_LEN, MPI_CHAR, 0, MPI_COMM_WORLD);
     MPI_Bcast(solving_algorithm, MAX_ARG_LEN, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&opts, sizeof(Options), MPI_BYTE, 0, MPI_COMM_WORLD); // Options is plain data
 
-    MPI_Barrier(MPI_COMM_WORLD); //? Barrier to make sure all processes have received the arguments -> Is this needed?
-
-    int start = NODE(0, size-1, size);
-    int end = NODE(size-1, 0, size);
+    omp_set_num_threads(opts.threads);
 
-    // Generate the maze
-    short* maze = generator_main(size, generation_algorithm, MPI_COMM_WORLD);
-    // printf("Maze generated\n");
-    // if (my_rank == 0)
-        // print_maze_complete(maze, size);
-    solver_main(size, maze, solving_algorithm, MPI_COMM_WORLD, start, end);
-    // printf("Maze solved\n");
+    MPI_Barrier(MPI_COMM_WORLD); //? Barrier to make sure all processes have received the arguments -> Is this needed?
 
-    MPI_Barrier(MPI_COMM_WORLD);
+    if (opts.stream) {
+        // Sequential, rank 0 does all the work
+        if (my_rank == 0) {
+            double t0 = MPI_Wtime();
+            bool kruskal = strcmp(generation_algorithm, "kruskal") == 0;
+            KruskalIOStats io = {};
+            bool ok = kruskal ? stream_maze_using_kruskal(opts.width, opts.height, opts.save_path, opts.seed, &io)
+                              : stream_maze_using_eller(opts.width, opts.height, opts.save_path, opts.seed);
+            if (!ok) {
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            if (opts.stats) {
+                double generate_s = MPI_Wtime() - t0;
+                fprintf(stderr, "maze %dx%d gen=%s seed=%llu streamed to %s\n", opts.width, opts.height, generation_algorithm, (unsigned long long)opts.seed, opts.save_path);
+                fprintf(stderr, "generate_s %.3f\n", generate_s);
+                if (kruskal) {
+                    // Scratch I/O of the edge buckets, and the maze file written afterwards
+                    double mb = 1024.0 * 1024.0;
+                    double maze_mb = (MAZE_FILE_PAYLOAD_OFFSET + maze_file_payload_bytes((node_t)opts.width * opts.height)) / mb;
+                    double write_s = generate_s - io.distribute_s - io.join_s;
+                    fprintf(stderr, "bucket_write_mb %.1f in %.3f s (%.1f MB/s)\n", io.bucket_bytes_written / mb, io.distribute_s, io.bucket_bytes_written / mb / io.distribute_s);
+                    fprintf(stderr, "bucket_read_mb %.1f in %.3f s (%.1f MB/s)\n", io.bucket_bytes_read / mb, io.join_s, io.bucket_bytes_read / mb / io.join_s);
+                    fprintf(stderr, "maze_write_mb %.1f in %.3f s (%.1f MB/s)\n", maze_mb, write_s, maze_mb / write_s);
+                }
+                fprintf(stderr, "peak_rss_mb %.3f\n", peak_rss_kb() / 1024.0);
+            }
+        }
+        MPI_Finalize();
+        return 0;
+    }
 
-    if (my_rank == 0)
-        print_maze_final(maze, size, start, end);
+    // Every process maps the maze file itself (the dimensions and layout come from its header)
+    MazeFile file;
+    if (strlen(opts.load_path) > 0) {
+        if (!file.open(opts.load_path)) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        opts.width = file.header().width;
+        opts.height = file.header().height;
+        opts.tiled = file.header().layout == MAZE_LAYOUT_TILED;
+    }
+    const MazeFile* maze_file = strlen(opts.load_path) > 0 ? &file : nullptr;
 
-    free(maze);
+    if (opts.slabs) {
+        if (opts.bitplanes) run_slabs<BitplaneCells>(opts, MPI_COMM_WORLD);
+        else run_slabs<PackedCells>(opts, MPI_COMM_WORLD);
+    } else if (opts.bitplanes) {
+        dispatch_grid<BitplaneCells>(opts, generation_algorithm, solving_algorithm, maze_file, MPI_COMM_WORLD);
+    } else {
+        dispatch_grid<PackedCells>(opts, generation_algorithm, solving_algorithm, maze_file, MPI_COMM_WORLD);
+    }
     
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mazefile.hpp"
+#include "grid.hpp"
+
+MazeFile::~MazeFile(){
+    if (data != nullptr){
+        munmap(data, bytes);
+    }
+}
+
+bool MazeFile::open(const char* path){
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0){
+        fprintf(stderr, "Error: Cannot open maze file '%s': %s\n", path, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < MAZE_FILE_PAYLOAD_OFFSET){
+        fprintf(stderr, "Error: '%s' is not a maze file (too small)\n", path);
+        close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping stays valid
+    if (mapped == MAP_FAILED){
+        fprintf(stderr, "Error: Cannot map maze file '%s': %s\n", path, strerror(errno));
+        return false;
+    }
+    data = mapped;
+    bytes = st.st_size;
+
+    const MazeFileHeader& h = header();
+    if (memcmp(h.magic, MAZE_FILE_MAGIC, sizeof(MAZE_FILE_MAGIC)) != 0){
+        fprintf(stderr, "Error: '%s' is not a maze file (bad magic)\n", path);
+        return false;
+    }
+    if (h.version != MAZE_FILE_VERSION){
+        fprintf(stderr, "Error: '%s' has version %u, expected %d\n", path, h.version, MAZE_FILE_VERSION);
+        return false;
+    }
+    if (h.layout != MAZE_LAYOUT_ROWS && h.layout != MAZE_LAYOUT_TILED){
+        fprintf(stderr, "Error: '%s' has an unknown layout %u\n", path, h.layout);
+        return false;
+    }
+    if (h.width < MIN_MAZE_DIM || h.width > MAX_MAZE_DIM || h.height < MIN_MAZE_DIM || h.height > MAX_MAZE_DIM){
+        fprintf(stderr, "Error: '%s' has invalid dimensions %dx%d\n", path, h.width, h.height);
+        return false;
+    }
+    // The cells are sized from the header but the grid from the dimensions, they have to agree
+    node_t expected = h.layout == MAZE_LAYOUT_TILED ? TiledGrid(h.width, h.height).cells() : DynamicGrid(h.width, h.height).cells();
+    if (h.cells != (uint64_t)expected){
+        fprintf(stderr, "Error: '%s' holds %llu cells, expected %lld for %dx%d\n", path, (unsigned long long)h.cells, (long long)expected, h.width, h.height);
+        return false;
+    }
+    if (bytes < MAZE_FILE_PAYLOAD_OFFSET + maze_file_payload_bytes(h.cells)){
+        fprintf(stderr, "Error: '%s' is truncated\n", path);
+        return false;
+    }
+    return true;
+}
+
+#define WRITER_BUFFER_WORDS (1 << 16)
+
+MazeFileWriter::~MazeFileWriter(){
+    if (file != nullptr){
+        fclose(file);
+    }
+}
+
+bool MazeFileWriter::open(const char* path, MazeFileHeader header){
+    memcpy(header.magic, MAZE_FILE_MAGIC, sizeof(MAZE_FILE_MAGIC));
+    header.version = MAZE_FILE_VERSION;
+
+    file = fopen(path, "wb");
+    if (file == nullptr){
+        fprintf(stderr, "Error: Cannot create maze file '%s': %s\n", path, strerror(errno));
+        return false;
+    }
+    static char padding[MAZE_FILE_PAYLOAD_OFFSET];
+    failed = fwrite(&header, sizeof(header), 1, file) != 1
+        || fwrite(padding, 1, MAZE_FILE_PAYLOAD_OFFSET - sizeof(header), file) != MAZE_FILE_PAYLOAD_OFFSET - sizeof(header);
+    buffer.reserve(WRITER_BUFFER_WORDS);
+    word = 0;
+    used = 0;
+    return true;
+}
+
+void MazeFileWriter::push_word(uint64_t w){
+    buffer.push_back(w);
+    if (buffer.size() == WRITER_BUFFER_WORDS){
+        failed = failed || fwrite(buffer.data(), sizeof(uint64_t), buffer.size(), file) != buffer.size();
+        buffer.clear();
+    }
+}
+
+void MazeFileWriter::write_bits(const uint64_t* words, node_t count){
+    for (node_t i = 0; count > 0; i++){
+        int bits = count < 64 ? (int)count : 64;
+        uint64_t w = bits < 64 ? words[i] & (((uint64_t)1 << bits) - 1) : words[i];
+        word |= w << used; // The low 64 - used bits of w fit in the current word
+        if (used + bits >= 64){
+            push_word(word);
+            word = used > 0 ? w >> (64 - used) : 0;
+            used = used + bits - 64;
+        } else {
+            used += bits;
+        }
+        count -= bits;
+    }
+}
+
+bool MazeFileWriter::close(){
+    if (used > 0){
+        push_word(word);
+        used = 0;
+    }
+    failed = failed || fwrite(buffer.data(), sizeof(uint64_t), buffer.size(), file) != buffer.size();
+    buffer.clear();
+    failed = fclose(file) != 0 || failed;
+    file = nullptr;
+    if (failed){
+        fprintf(stderr, "Error: Writing the maze file failed\n");
+    }
+    return !failed;
+}
+
+// Write the C plane as 64-bit words
+static void write_c_plane(MazeFileWriter& writer, BitplaneCells& maze){
+    maze.for_each_plane(PLANE_C, [&](void* buf, size_t bytes) {
+        writer.write_bits((const uint64_t*)buf, maze.count());
+    });
+}
+
+static void write_c_plane(MazeFileWriter& writer, PackedCells& maze){
+    // Pack the C bits a block of words at a time
+    const size_t block_words = 4096;
+    uint64_t words[block_words];
+    node_t n = maze.count();
+    for (node_t first = 0; first < n; first += block_words * 64){
+        node_t count = std::min<node_t>(block_words * 64, n - first);
+        for (node_t w = 0; w < (count + 63) / 64; w++){
+            uint64_t word = 0;
+            for (node_t i = 0; i < 64 && w * 64 + i < count; i++){
+                word |= (uint64_t)maze.is_c(first + w * 64 + i) << i;
+            }
+            words[w] = word;
+        }
+        writer.write_bits(words, count);
+    }
+}
+
+template <class Cells>
+bool save_maze(const char* path, Cells& maze, MazeFileHeader header){
+    header.cells = maze.count();
+    MazeFileWriter writer;
+    if (!writer.open(path, header)){
+        return false;
+    }
+    write_c_plane(writer, maze);
+    return writer.close();
+}
+
+// Bitplanes use the mapped plane in place
+static void map_c_plane(BitplaneCells& maze, const uint64_t* words){
+    maze.map_c(words);
+}
+
+static void map_c_plane(PackedCells& maze, const uint64_t* words){
+    node_t n = maze.count();
+    for (node_t w = 0; w < (n + 63) / 64; w++){
+        for (uint64_t word = words[w]; word != 0; word &= word - 1){
+            maze.set_c(w * 64 + __builtin_ctzll(word));
+        }
+    }
+}
+
+template <class Cells>
+Cells load_maze(const MazeFile& file){
+    Cells maze(file.header().cells, MAZE_PLANES & ~PLANE_C);
+    map_c_plane(maze, file.c_plane());
+    return maze;
+}
+
+#define INSTANTIATE_MAZEFILE(Cells) \
+    template bool save_maze<Cells>(const char* path, Cells& maze, MazeFileHeader header); \
+    template Cells load_maze<Cells>(const MazeFile& file);
+INSTANTIATE_MAZEFILE(PackedCells)
+INSTANTIATE_MAZEFILE(BitplaneCells)
@@ -0,0 +1,92 @@
+#ifndef MAZEFILE_H
+#define MAZEFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+
+#include "defs.hpp"
+#include "cells.hpp"
+
+// Binary maze file: a generated maze saved once (-o) and solved any number of times (-i) without regenerating it
+// | header | padding up to MAZE_FILE_PAYLOAD_OFFSET | C plane |
+// - The payload is the C/W bit of every node id, 1 bit per cell in 64-bit little endian words, in the storage order
+//   of the layout the maze was generated with (row by row, or tiled, see grid.hpp)
+// - It is exactly the C plane of BitplaneCells, so loading into bitplanes just mmaps the file and points the cells
+//   at it (the load costs the page faults of the cells actually read), PackedCells copy the bits out
+// - The payload starts on a page boundary so the mapping can be used in place
+
+#define MAZE_FILE_MAGIC "COLMAZE"
+#define MAZE_FILE_VERSION 1
+#define MAZE_FILE_PAYLOAD_OFFSET 4096
+
+// Storage order of the payload
+#define MAZE_LAYOUT_ROWS 0
+#define MAZE_LAYOUT_TILED 1
+
+struct MazeFileHeader {
+    char magic[8]; // MAZE_FILE_MAGIC
+    uint32_t version; // MAZE_FILE_VERSION
+    uint32_t layout; // MAZE_LAYOUT_*
+    int32_t width;
+    int32_t height;
+    uint64_t seed; // Seed the maze was generated with, 0 if unknown
+    uint64_t cells; // Number of node ids in the payload (grid.cells(), includes the padding of a tiled layout)
+    char generator[MAX_ARG_LEN]; // Generation algorithm
+};
+
+// Read-only mapping of a maze file
+class MazeFile {
+public:
+    MazeFile() : data(nullptr), bytes(0) {}
+    ~MazeFile();
+    MazeFile(const MazeFile&) = delete;
+
+    // Map the file and check its header, prints the problem and returns false if it is not a valid maze file
+    bool open(const char* path);
+
+    const MazeFileHeader& header() const { return *(const MazeFileHeader*)data; }
+    const uint64_t* c_plane() const { return (const uint64_t*)((const char*)data + MAZE_FILE_PAYLOAD_OFFSET); }
+
+private:
+    void* data;
+    size_t bytes;
+};
+
+// Sequential writer: the payload is appended a run of bits at a time (e.g. a row), so a maze can be written while it
+// is being generated without ever holding it in memory
+class MazeFileWriter {
+public:
+    MazeFileWriter() : file(nullptr), word(0), used(0), failed(false) {}
+    ~MazeFileWriter();
+    MazeFileWriter(const MazeFileWriter&) = delete;
+
+    // Create the file and write the header (magic / version are filled in, cells must be set), false on error
+    bool open(const char* path, MazeFileHeader header);
+    // Append the first count bits of words (bit i of the run is bit i % 64 of words[i / 64])
+    void write_bits(const uint64_t* words, node_t count);
+    // Flush everything and close the file, false if any write failed
+    bool close();
+
+private:
+    void push_word(uint64_t w);
+
+    FILE* file;
+    std::vector<uint64_t> buffer; // Complete words waiting to be written
+    uint64_t word; // Word being filled
+    int used; // Bits of word already filled
+    bool failed;
+};
+
+// Payload size in bytes for a number of node ids
+inline size_t maze_file_payload_bytes(node_t cells) { return ((cells + 63) / 64) * sizeof(uint64_t); }
+
+// Write the C plane of a maze with the given header (version / magic / cells are filled in), returns false on error
+template <class Cells>
+bool save_maze(const char* path, Cells& maze, MazeFileHeader header);
+
+// Cells for solving a mapped maze (MAZE_PLANES, the C plane coming from the file), the file must outlive them
+template <class Cells>
+Cells load_maze(const MazeFile& file);
+
+#endif // MAZEFILE_H
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "mazeprint.hpp"
+
+// Cell index into the lookup tables: C bit | P bit << 1
+#define CELL_INDEX(maze, node) ((maze).is_c(node) | ((maze).is_p(node) << 1))
+
+static const char ASCII_CELLS[4] = {'*', ' ', '*', 'P'};
+static const unsigned char PGM_CELLS[4] = {0, 255, 0, 128};
+#define PGM_ENDPOINT 64
+
+OutputBuffer::OutputBuffer(FILE* out) : OutputBuffer([out](const char* data, size_t bytes) { return fwrite(data, 1, bytes, out) == bytes; }) {}
+
+char* OutputBuffer::reserve(size_t bytes) {
+    if (used + bytes > buffer.size()) flush();
+    if (bytes > buffer.size()) buffer.resize(bytes);
+    return buffer.data() + used;
+}
+
+void OutputBuffer::write(const char* data, size_t bytes) {
+    memcpy(reserve(bytes), data, bytes);
+    commit(bytes);
+}
+
+bool OutputBuffer::flush() {
+    if (used > 0) failed = !sink(buffer.data(), used) || failed;
+    used = 0;
+    return !failed;
+}
+
+void write_maze_header(OutputBuffer& buffer, node_t width, node_t height, int format) {
+    char header[64];
+    if (format == OUTPUT_PBM) {
+        buffer.write(header, snprintf(header, sizeof(header), "P4\n%lld %lld\n", (long long)width, (long long)height));
+    } else if (format == OUTPUT_PGM) {
+        buffer.write(header, snprintf(header, sizeof(header), "P5\n%lld %lld\n255\n", (long long)width, (long long)height));
+    }
+}
+
+template <class GridT, class Cells>
+static void write_ascii(OutputBuffer& buffer, const GridT& grid, Cells& maze, node_t first_row, node_t last_row, node_t start, node_t end) {
+    node_t width = grid.width();
+    for (node_t row = first_row; row < last_row; row++) {
+        char* line = buffer.reserve(width + 1);
+        for (node_t col = 0; col < width; col++) {
+            line[col] = ASCII_CELLS[CELL_INDEX(maze, grid.node(row, col))];
+        }
+        line[width] = '\n';
+        // The entry / exit are open cells, they replace whatever the table gave
+        if (start >= 0 && grid.row(start) == row && maze.is_c(start)) line[grid.col(start)] = 'S';
+        if (end >= 0 && grid.row(end) == row && maze.is_c(end)) line[grid.col(end)] = 'E';
+        buffer.commit(width + 1);
+    }
+}
+
+template <class GridT, class Cells>
+static void write_pbm(OutputBuffer& buffer, const GridT& grid, Cells& maze, node_t first_row, node_t last_row) {
+    node_t width = grid.width();
+    node_t row_bytes = (width + 7) / 8;
+    for (node_t row = first_row; row < last_row; row++) {
+        unsigned char* line = (unsigned char*)buffer.reserve(row_bytes);
+        memset(line, 0, row_bytes);
+        for (node_t col = 0; col < width; col++) {
+            line[col >> 3] |= (!maze.is_c(grid.node(row, col))) << (7 - (col & 7)); // 1 is black, most significant bit first
+        }
+        buffer.commit(row_bytes);
+    }
+}
+
+template <class GridT, class Cells>
+static void write_pgm(OutputBuffer& buffer, const GridT& grid, Cells& maze, node_t first_row, node_t last_row, node_t start, node_t end) {
+    node_t width = grid.width();
+    for (node_t row = first_row; row < last_row; row++) {
+        unsigned char* line = (unsigned char*)buffer.reserve(width);
+        for (node_t col = 0; col < width; col++) {
+            line[col] = PGM_CELLS[CELL_INDEX(maze, grid.node(row, col))];
+        }
+        if (start >= 0 && grid.row(start) == row) line[grid.col(start)] = PGM_ENDPOINT;
+        if (end >= 0 && grid.row(end) == row) line[grid.col(end)] = PGM_ENDPOINT;
+        buffer.commit(width);
+    }
+}
+
+template <class GridT, class Cells>
+void write_maze_rows(OutputBuffer& buffer, const GridT& grid, Cells& maze, node_t first_row, node_t last_row, node_t start, node_t end, int format) {
+    switch (format) {
+        case OUTPUT_PBM: write_pbm(buffer, grid, maze, first_row, last_row); break;
+        case OUTPUT_PGM: write_pgm(buffer, grid, maze, first_row, last_row, start, end); break;
+        default: write_ascii(buffer, grid, maze, first_row, last_row, start, end); break;
+    }
+}
+
+template <class GridT, class Cells>
+bool write_maze(FILE* out, const GridT& grid, Cells& maze, node_t start, node_t end, int format) {
+    OutputBuffer buffer(out);
+    write_maze_header(buffer, grid.width(), grid.height(), format);
+    write_maze_rows(buffer, grid, maze, 0, grid.height(), start, end, format);
+    return buffer.flush() && fflush(out) == 0;
+}
+
+#define INSTANTIATE_WRITE_MAZE(GridT, Cells) \
+    template void write_maze_rows<GridT, Cells>(OutputBuffer& buffer, const GridT& grid, Cells& maze, node_t first_row, node_t last_row, node_t start, node_t end, int format); \
+    template bool write_maze<GridT, Cells>(FILE* out, const GridT& grid, Cells& maze, node_t start, node_t end, int format);
+FOR_EACH_MAZE_TYPE(INSTANTIATE_WRITE_MAZE)
@@ -0,0 +1,58 @@
+#ifndef MAZEPRINT_H
+#define MAZEPRINT_H
+
+#include <stdio.h>
+#include <vector>
+#include <functional>
+
+#include "defs.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
+
+// Output of the final maze
+// - Rows are rendered into a large buffer through a lookup table over the cell bits and written with one fwrite per
+//   buffer instead of one printf per cell
+// - Besides the ASCII format of the assignment the maze can be written as a binary PBM / PGM image (one pixel per cell)
+
+#define OUTPUT_ASCII 0 // * for walls, space for open cells, P for the path, S / E for the entry / exit
+#define OUTPUT_PBM 1 // P4 bitmap, walls are black
+#define OUTPUT_PGM 2 // P5 greymap, walls black, open cells white, path and entry / exit in shades of grey
+
+// Bytes rendered before each fwrite (at least one row of the largest maze)
+#define OUTPUT_BUFFER_BYTES (1 << 20)
+
+// Fixed size output buffer, rows are rendered in place and handed to the sink in one piece when it fills up
+// (the sink is an fwrite for a FILE*, or e.g. an MPI_Send to the rank doing the output)
+class OutputBuffer {
+public:
+    typedef std::function<bool(const char* data, size_t bytes)> Sink;
+
+    OutputBuffer(Sink sink) : sink(sink), buffer(OUTPUT_BUFFER_BYTES), used(0), failed(false) {}
+    OutputBuffer(FILE* out);
+
+    // Room for bytes more bytes (flushing first if needed), the caller fills them and calls commit
+    char* reserve(size_t bytes);
+    void commit(size_t bytes) { used += bytes; }
+    void write(const char* data, size_t bytes);
+    // Hand what is buffered to the sink, false if the sink failed (now or before)
+    bool flush();
+
+private:
+    Sink sink;
+    std::vector<char> buffer;
+    size_t used;
+    bool failed;
+};
+
+// Image header of the format (nothing for ASCII)
+void write_maze_header(OutputBuffer& buffer, node_t width, node_t height, int format);
+
+// Render the rows [first_row, last_row) of the grid, start / end are -1 if they are not in the grid
+template <class GridT, class Cells>
+void write_maze_rows(OutputBuffer& buffer, const GridT& grid, Cells& maze, node_t first_row, node_t last_row, node_t start, node_t end, int format);
+
+// Write the maze in the given format, returns false if writing failed
+template <class GridT, class Cells>
+bool write_maze(FILE* out, const GridT& grid, Cells& maze, node_t start, node_t end, int format);
+
+#endif // MAZEPRINT_H
@@ -0,0 +1,22 @@
+#include <mpi.h>
+#include <sys/resource.h>
+
+#include "mpiutils.hpp"
+
+void bcast_chunked(void* buf, size_t count, MPI_Datatype type, int root, MPI_Comm comm){
+    int type_size;
+    MPI_Type_size(type, &type_size);
+    char* ptr = (char*)buf;
+    while (count > 0){
+        size_t chunk = count < (size_t)MPI_CHUNK_ELEMS ? count : (size_t)MPI_CHUNK_ELEMS;
+        MPI_Bcast(ptr, (int)chunk, type, root, comm);
+        ptr += chunk * type_size;
+        count -= chunk;
+    }
+}
+
+long peak_rss_kb(){
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // kilobytes on linux
+}
@@ -0,0 +1,52 @@
+#ifndef MPIUTILS_H
+#define MPIUTILS_H
+
+#include <mpi.h>
+#include <stddef.h>
+#include <algorithm>
+#include <vector>
+
+#include "defs.hpp"
+
+// MPI counts are plain ints, so buffers with more than INT_MAX elements (e.g. a 64K x 64K maze) have to be sent in pieces
+// Largest number of elements sent in a single MPI call
+#define MPI_CHUNK_ELEMS (1 << 30)
+
+// Split count items over the ranks (the first count % commSize ranks get one more), returns the first item of rank
+inline node_t split_offset(node_t count, int rank, int commSize) {
+    return rank * (count / commSize) + std::min<node_t>(rank, count % commSize);
+}
+
+// Broadcast count elements of type from root, splitting into chunks of at most MPI_CHUNK_ELEMS
+void bcast_chunked(void* buf, size_t count, MPI_Datatype type, int root, MPI_Comm comm);
+
+// Broadcast the given planes of a cell storage (see cells.hpp)
+template <class Cells>
+void bcast_cells(Cells& cells, unsigned planes, int root, MPI_Comm comm) {
+    cells.for_each_plane(planes, [&](void* buf, size_t bytes) {
+        bcast_chunked(buf, bytes, MPI_BYTE, root, comm);
+    });
+}
+
+// Mark P on every rank the cells of a path found in pieces (each rank passes the cells it walked, in any order)
+template <class Cells>
+void share_path(Cells& cells, const std::vector<node_t>& path, MPI_Comm comm) {
+    int size;
+    MPI_Comm_size(comm, &size);
+    int count = path.size();
+    std::vector<int> counts(size), displs(size, 0);
+    MPI_Allgather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+    for (int r = 1; r < size; r++) {
+        displs[r] = displs[r - 1] + counts[r - 1];
+    }
+    std::vector<node_t> all(displs[size - 1] + counts[size - 1]);
+    MPI_Allgatherv(path.data(), count, MPI_NODE_T, all.data(), counts.data(), displs.data(), MPI_NODE_T, comm);
+    for (node_t node : all) {
+        cells.set_p(node);
+    }
+}
+
+// Peak resident set size of the calling process in kilobytes
+long peak_rss_kb();
+
+#endif // MPIUTILS_H
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#include "queryfile.hpp"
+#include "mazeprint.hpp"
+
+// Longest line of a query file (4 coordinates and their separators, with room for spaces)
+#define QUERY_LINE_LEN 256
+
+bool read_queries(const char* path, int width, int height, std::vector<Query>& queries){
+    bool from_stdin = strcmp(path, "-") == 0;
+    FILE* in = from_stdin ? stdin : fopen(path, "r");
+    if (in == nullptr){
+        fprintf(stderr, "Error: Cannot open query file '%s': %s\n", path, strerror(errno));
+        return false;
+    }
+    char line[QUERY_LINE_LEN];
+    long line_no = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), in) != nullptr){
+        line_no++;
+        for (char* c = line; *c; ++c){
+            if (*c == ',') *c = ' ';
+        }
+        char* p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\n' || *p == '\0' || *p == '#'){
+            continue;
+        }
+        long v[4];
+        int n = 0;
+        for (; n < 4; n++){
+            char* end;
+            v[n] = strtol(p, &end, 10);
+            if (end == p) break;
+            p = end;
+        }
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+        if (n < 4 || *p != '\0'){
+            fprintf(stderr, "Error: %s:%ld: expected start_row start_col end_row end_col\n", path, line_no);
+            ok = false;
+        } else if (v[0] < 0 || v[0] >= height || v[2] < 0 || v[2] >= height || v[1] < 0 || v[1] >= width || v[3] < 0 || v[3] >= width){
+            fprintf(stderr, "Error: %s:%ld: cell outside the %dx%d maze\n", path, line_no, width, height);
+            ok = false;
+        } else {
+            queries.push_back(Query{(int32_t)v[0], (int32_t)v[1], (int32_t)v[2], (int32_t)v[3]});
+        }
+    }
+    if (ok && ferror(in)){
+        fprintf(stderr, "Error: Reading query file '%s' failed\n", path);
+        ok = false;
+    }
+    if (!from_stdin) fclose(in);
+    return ok;
+}
+
+bool write_answers(const char* path, const std::vector<Query>& queries, const std::vector<node_t>& distances, int format){
+    bool to_stdout = strcmp(path, "-") == 0;
+    FILE* out = to_stdout ? stdout : fopen(path, "wb");
+    if (out == nullptr){
+        fprintf(stderr, "Error: Cannot create answer file '%s': %s\n", path, strerror(errno));
+        return false;
+    }
+    bool ok;
+    {
+        OutputBuffer buffer(out);
+        if (format == ANSWERS_BINARY){
+            for (node_t distance : distances){
+                int64_t value = distance; // The file is little endian, like the maze files
+                buffer.write((const char*)&value, sizeof(value));
+            }
+        } else {
+            const char* header = "start_row,start_col,end_row,end_col,distance\n";
+            buffer.write(header, strlen(header));
+            for (size_t i = 0; i < queries.size(); i++){
+                const Query& q = queries[i];
+                char* p = buffer.reserve(QUERY_LINE_LEN);
+                buffer.commit(snprintf(p, QUERY_LINE_LEN, "%d,%d,%d,%d,%lld\n", q.start_row, q.start_col, q.end_row, q.end_col, (long long)distances[i]));
+            }
+        }
+        ok = buffer.flush();
+    }
+    if (!to_stdout){
+        ok = fclose(out) == 0 && ok;
+    } else {
+        ok = fflush(out) == 0 && ok;
+    }
+    if (!ok){
+        fprintf(stderr, "Error: Writing the answers to '%s' failed\n", path);
+    }
+    return ok;
+}
@@ -0,0 +1,33 @@
+#ifndef QUERYFILE_H
+#define QUERYFILE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "defs.hpp"
+
+// Batch queries (--queries): many start / end pairs answered on one maze in a single run
+// - Input is text, one query per line: start_row start_col end_row end_col (separated by spaces or commas), empty
+//   lines and lines starting with # are skipped. "-" reads from stdin
+// - Answers are the path lengths in steps (-1 if the cells are not connected, or one of them is a wall), in the
+//   order of the queries, written as
+//   | csv | start_row,start_col,end_row,end_col,distance per line, after a header line
+//   | bin | one little-endian int64 per query, nothing else
+//   "-" writes to stdout
+
+#define ANSWERS_CSV 0
+#define ANSWERS_BINARY 1
+
+struct Query {
+    int32_t start_row, start_col;
+    int32_t end_row, end_col;
+};
+
+// Read the queries of path (rank 0 only), checking that the cells are inside a width x height maze
+// Prints the problem and returns false on error
+bool read_queries(const char* path, int width, int height, std::vector<Query>& queries);
+
+// Write the answers in the given format (ANSWERS_*), false on error
+bool write_answers(const char* path, const std::vector<Query>& queries, const std::vector<node_t>& distances, int format);
+
+#endif // QUERYFILE_H
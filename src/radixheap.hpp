@@ -0,0 +1,57 @@
+#ifndef RADIXHEAP_H
+#define RADIXHEAP_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+#include "defs.hpp"
+
+// Monotone priority queue of entries with a node_t key f (Ahuja et al., "Faster algorithms for the shortest path
+// problem"): f must never be below the last f popped, which holds for Dijkstra and for A* with a consistent heuristic
+// - Bucket 0 holds the entries at the last f popped, bucket i > 0 those whose highest bit differing from it is bit i - 1
+// - When bucket 0 is empty the lowest non-empty bucket is spread again around its smallest f, an entry moves to a lower
+//   bucket every time so it is moved at most 64 times. Pushes and pops are appends to vectors, unlike the sift downs of
+//   a binary heap whose cache misses dominate with millions of open entries
+// - Unlike the bucket ring of astar.cpp it works whatever the largest step of f
+// - Bucket 0 is popped last in first out, which prefers the deepest of the entries with the same f
+template <class Entry>
+class RadixHeap {
+public:
+    RadixHeap() : buckets(65), last(0), count(0) {}
+
+    void push(const Entry& entry) {
+        buckets[bucket(entry.f)].push_back(entry);
+        count++;
+    }
+    bool empty() const { return count == 0; }
+    Entry pop() {
+        if (buckets[0].empty()) {
+            int i = 1;
+            while (buckets[i].empty()) i++;
+            last = INT64_MAX;
+            for (const Entry& entry : buckets[i]) last = std::min(last, entry.f);
+            for (const Entry& entry : buckets[i]) buckets[bucket(entry.f)].push_back(entry);
+            buckets[i].clear();
+        }
+        Entry entry = buckets[0].back();
+        buckets[0].pop_back();
+        count--;
+        return entry;
+    }
+    // Empty the heap for a new search (keeps the memory)
+    void clear() {
+        for (std::vector<Entry>& bucket : buckets) bucket.clear();
+        last = 0;
+        count = 0;
+    }
+
+private:
+    int bucket(node_t f) const { return f == last ? 0 : 64 - __builtin_clzll((uint64_t)(f ^ last)); }
+
+    std::vector<std::vector<Entry>> buckets;
+    node_t last;
+    node_t count;
+};
+
+#endif // RADIXHEAP_H
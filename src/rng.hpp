@@ -0,0 +1,87 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// Counter-based random numbers: Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3")
+// - The output is a pure function of (key, counter), so any rank / thread can draw the number of any cell on its own
+//   without sharing generator state, and a run is reproducible from its seed whatever the number of ranks
+// - The key is the seed (--seed), the counter is (index, stream): every use of randomness gets its own stream below,
+//   indexed by whatever it is drawn for (a cell id, a row, ...)
+
+// Streams, one per use of randomness
+#define RNG_STREAM_WEIGHT 0 // Node weights of the graph (kruskal), indexed by row-major graph id / 4
+#define RNG_STREAM_BFS 1 // Start node of the BFS generator
+#define RNG_STREAM_BFS_SHUFFLE 2 // Frontier shuffles of the BFS generator
+#define RNG_STREAM_BFS_BOTTOM_UP 3 // First side a node checks in a bottom-up level, indexed by (level, node)
+#define RNG_STREAM_ELLER 4 // Seed of Eller's generator, indexed by the first tree row generated
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+// 128 random bits for a 128 bit counter and a 64 bit key
+struct PhiloxBlock {
+    uint32_t v[4];
+};
+
+inline PhiloxBlock philox4x32(uint64_t counter_lo, uint64_t counter_hi, uint64_t key) {
+    uint32_t c0 = (uint32_t)counter_lo, c1 = (uint32_t)(counter_lo >> 32);
+    uint32_t c2 = (uint32_t)counter_hi, c3 = (uint32_t)(counter_hi >> 32);
+    uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)p1;
+        c3 = (uint32_t)p0;
+        c0 = n0;
+        c2 = n2;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    return PhiloxBlock{{c0, c1, c2, c3}};
+}
+
+// 64 random bits for (seed, stream, index)
+inline uint64_t random_at(uint64_t seed, uint64_t stream, uint64_t index) {
+    PhiloxBlock block = philox4x32(index, stream, seed);
+    return ((uint64_t)block.v[1] << 32) | block.v[0];
+}
+
+// Weight in [1, 255] of the graph node with row-major id index (one Philox block covers 4 nodes)
+inline int weight_from_bits(uint32_t bits) { return 1 + (int)(((uint64_t)bits * 255) >> 32); }
+inline int weight_at(uint64_t seed, uint64_t index) {
+    return weight_from_bits(philox4x32(index >> 2, RNG_STREAM_WEIGHT, seed).v[index & 3]);
+}
+
+// Call f(index, weight_at(seed, index)) for index in [first, last), one Philox block per 4 weights
+template <class F>
+inline void for_each_weight(uint64_t seed, uint64_t first, uint64_t last, F f) {
+    for (uint64_t block = first >> 2; block << 2 < last; block++) {
+        PhiloxBlock bits = philox4x32(block, RNG_STREAM_WEIGHT, seed);
+        for (uint64_t index = block << 2; index < (block << 2) + 4; index++) {
+            if (index >= first && index < last) f(index, weight_from_bits(bits.v[index & 3]));
+        }
+    }
+}
+
+// A stream as a UniformRandomBitGenerator (for std::shuffle, the distributions, ...): draws random_at(seed, stream, i)
+// for i = 0, 1, ... so a copy with the same seed and stream on another rank returns the same sequence
+class PhiloxStream {
+public:
+    typedef uint64_t result_type;
+    PhiloxStream(uint64_t seed, uint64_t stream) : seed(seed), stream(stream), index(0) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+    result_type operator()() { return random_at(seed, stream, index++); }
+
+private:
+    uint64_t seed, stream, index;
+};
+
+#endif // RNG_H
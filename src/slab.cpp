@@ -0,0 +1,108 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+
+#include "slab.hpp"
+#include "mazeprint.hpp"
+
+#define SLAB_OUTPUT_TAG 1
+
+Slab::Slab(int width, int height, MPI_Comm comm) : width(width), height(height) {
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &ranks);
+    int graph_rows = height / 2;
+    int base = graph_rows / ranks;
+    int rem = graph_rows % ranks;
+    first_row = 2 * (rank * base + (rank < rem ? rank : rem));
+    rows = 2 * (base + (rank < rem ? 1 : 0));
+    up = rank > 0 ? rank - 1 : MPI_PROC_NULL;
+    down = rank < ranks - 1 ? rank + 1 : MPI_PROC_NULL;
+}
+
+int Slab::owner(int row) const {
+    int graph_row = row / 2;
+    int graph_rows = height / 2;
+    int base = graph_rows / ranks;
+    int rem = graph_rows % ranks;
+    if (graph_row < rem * (base + 1)) return graph_row / (base + 1);
+    return rem + (graph_row - rem * (base + 1)) / base;
+}
+
+// C bits of a local row, 64 per word
+template <class Cells>
+static void pack_row(const Slab& slab, Cells& maze, int local_row, std::vector<uint64_t>& words) {
+    std::fill(words.begin(), words.end(), 0);
+    node_t first = (node_t)local_row * slab.width;
+    for (int col = 0; col < slab.width; col++) {
+        words[col >> 6] |= (uint64_t)maze.is_c(first + col) << (col & 63);
+    }
+}
+
+template <class Cells>
+static void unpack_row(const Slab& slab, Cells& maze, int local_row, const std::vector<uint64_t>& words) {
+    node_t first = (node_t)local_row * slab.width;
+    for (int col = 0; col < slab.width; col++) {
+        if ((words[col >> 6] >> (col & 63)) & 1) maze.set_c(first + col);
+    }
+}
+
+template <class Cells>
+void exchange_halos(const Slab& slab, Cells& maze, MPI_Comm comm) {
+    int words = (slab.width + 63) / 64;
+    std::vector<uint64_t> send(words), recv(words);
+
+    // First owned row goes up, the ghost row below comes from the rank below
+    pack_row(slab, maze, 1, send);
+    MPI_Sendrecv(send.data(), words, MPI_UINT64_T, slab.up, 0, recv.data(), words, MPI_UINT64_T, slab.down, 0, comm, MPI_STATUS_IGNORE);
+    if (slab.down != MPI_PROC_NULL) unpack_row(slab, maze, slab.rows + 1, recv);
+
+    // Last owned row goes down, the ghost row above comes from the rank above
+    pack_row(slab, maze, slab.rows, send);
+    MPI_Sendrecv(send.data(), words, MPI_UINT64_T, slab.down, 0, recv.data(), words, MPI_UINT64_T, slab.up, 0, comm, MPI_STATUS_IGNORE);
+    if (slab.up != MPI_PROC_NULL) unpack_row(slab, maze, 0, recv);
+}
+
+template <class Cells>
+bool write_slab_maze(FILE* out, const Slab& slab, Cells& maze, int format, MPI_Comm comm) {
+    DynamicGrid grid = slab.grid();
+    node_t start = slab.owns(0) ? slab.node(0, slab.width - 1) : -1;
+    node_t end = slab.owns(slab.height - 1) ? slab.node(slab.height - 1, 0) : -1;
+
+    if (slab.rank != 0) {
+        // Every full buffer is one message, an empty message ends the slab
+        OutputBuffer buffer([&](const char* data, size_t bytes) {
+            return MPI_Send(data, (int)bytes, MPI_CHAR, 0, SLAB_OUTPUT_TAG, comm) == MPI_SUCCESS;
+        });
+        write_maze_rows(buffer, grid, maze, 1, slab.rows + 1, start, end, format);
+        buffer.flush();
+        MPI_Send(nullptr, 0, MPI_CHAR, 0, SLAB_OUTPUT_TAG, comm);
+        return true;
+    }
+
+    OutputBuffer buffer(out);
+    write_maze_header(buffer, slab.width, slab.height, format);
+    write_maze_rows(buffer, grid, maze, 1, slab.rows + 1, start, end, format);
+    bool ok = buffer.flush();
+
+    std::vector<char> chunk;
+    for (int source = 1; source < slab.ranks; source++) {
+        while (true) {
+            MPI_Status status;
+            int bytes;
+            MPI_Probe(source, SLAB_OUTPUT_TAG, comm, &status);
+            MPI_Get_count(&status, MPI_CHAR, &bytes);
+            chunk.resize(bytes > 0 ? bytes : 1);
+            MPI_Recv(chunk.data(), bytes, MPI_CHAR, source, SLAB_OUTPUT_TAG, comm, MPI_STATUS_IGNORE);
+            if (bytes == 0) break;
+            ok = fwrite(chunk.data(), 1, bytes, out) == (size_t)bytes && ok;
+        }
+    }
+    return fflush(out) == 0 && ok;
+}
+
+#define INSTANTIATE_SLAB(Cells) \
+    template void exchange_halos<Cells>(const Slab& slab, Cells& maze, MPI_Comm comm); \
+    template bool write_slab_maze<Cells>(FILE* out, const Slab& slab, Cells& maze, int format, MPI_Comm comm);
+INSTANTIATE_SLAB(PackedCells)
+INSTANTIATE_SLAB(BitplaneCells)
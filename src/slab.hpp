@@ -0,0 +1,45 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <mpi.h>
+#include <stdio.h>
+
+#include "defs.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
+
+// Slab mode (--slabs): instead of every rank holding a replica of the whole maze, rank k owns a contiguous slab of
+// maze rows plus one ghost row above and below it (copies of the neighbours' boundary rows)
+// - Slabs are whole rows of the tree (pairs of maze rows), the graph rows are split like the frontiers elsewhere:
+//   the first (graph rows % ranks) ranks get one more
+// - The slab cells are a row-major grid of width x (rows + 2): local row 0 is the ghost row above, local rows
+//   1..rows are owned, local row rows + 1 is the ghost row below
+// - Memory per rank is O(width * height / ranks), so the largest maze grows linearly with the number of ranks
+class Slab {
+public:
+    Slab(int width, int height, MPI_Comm comm);
+
+    int width, height; // The whole maze
+    int first_row, rows; // Owned maze rows [first_row, first_row + rows)
+    int rank, ranks;
+    int up, down; // Ranks owning the rows above / below the slab, MPI_PROC_NULL at the top / bottom of the maze
+
+    DynamicGrid grid() const { return DynamicGrid(width, rows + 2); }
+    bool owns(int row) const { return row >= first_row && row < first_row + rows; }
+    int owner(int row) const;
+    // Local node of a maze cell in (or next to) the slab
+    node_t node(int row, int col) const { return (node_t)(row - first_row + 1) * width + col; }
+    // Maze row of a local row
+    int global_row(int local_row) const { return local_row - 1 + first_row; }
+};
+
+// Copy the C bits of the boundary rows into the neighbours' ghost rows
+template <class Cells>
+void exchange_halos(const Slab& slab, Cells& maze, MPI_Comm comm);
+
+// Write the whole maze (see mazeprint.hpp) from rank 0, the other ranks render their slab and send it over in
+// OUTPUT_BUFFER_BYTES pieces, one rank after the other. Returns false on rank 0 if writing failed
+template <class Cells>
+bool write_slab_maze(FILE* out, const Slab& slab, Cells& maze, int format, MPI_Comm comm);
+
+#endif // SLAB_H
@@ -0,0 +1,226 @@
+#include <mpi.h>
+#include <vector>
+#include <stdlib.h>
+
+#include "astar.hpp"
+#include "dijkstra.hpp"
+#include "mpiutils.hpp"
+
+// A* towards end with h(node) = Manhattan distance to end
+// - Every step costs at least 1, so h never overestimates and is consistent: f = g + h never decreases along a path,
+//   and a cell is final the first time it leaves the open list (it is then closed in the VISITED_SOLVE bit)
+// - One step changes g by at most MAX_CELL_COST and h by 1, so the open list only spans MAX_CELL_COST + 2 values of f
+//   above the current one: it is a ring of that many buckets (a monotone bucket queue), push and pop are O(1)
+// - Entries are (cell, g << 2 | parent direction index) and are never updated: a cell reached again with a lower g
+//   just gets another entry, the later ones are dropped when they come out of the queue after the cell is closed
+// - A bucket is popped last in first out, which prefers the deepest of the cells with the same f
+
+#define ASTAR_RING (MAX_CELL_COST + 2)
+#define ASTAR_PATH_TAG 7
+#define ASTAR_INFINITY INT64_MAX
+
+struct OpenEntry {
+    node_t node;
+    node_t g_dir; // g << 2 | DIR_INDEX(direction of the parent)
+};
+
+// The open list, buckets by f
+class BucketQueue {
+public:
+    // f must be less than span above every other f in the queue
+    BucketQueue(node_t span = ASTAR_RING) : buckets(span), current(0), count(0) {}
+
+    // With several ranks (astar_distributed) f may be below the last min_f() or far above it when the queue ran empty
+    // meanwhile, so the scan restarts from it
+    void push(node_t f, OpenEntry entry) {
+        if (count == 0 || f < current) current = f;
+        buckets[f % buckets.size()].push_back(entry);
+        count++;
+    }
+    bool empty() const { return count == 0; }
+
+    // Smallest f with an entry (the queue must not be empty)
+    node_t min_f() {
+        while (buckets[current % buckets.size()].empty()) current++;
+        return current;
+    }
+    OpenEntry pop() {
+        std::vector<OpenEntry>& bucket = buckets[min_f() % buckets.size()];
+        OpenEntry entry = bucket.back();
+        bucket.pop_back();
+        count--;
+        return entry;
+    }
+
+private:
+    std::vector<std::vector<OpenEntry>> buckets;
+    node_t current;
+    node_t count;
+};
+
+template <class GridT>
+static node_t manhattan(const GridT& grid, node_t node, node_t end) {
+    return llabs(grid.row(node) - grid.row(end)) + llabs(grid.col(node) - grid.col(end));
+}
+
+template <class GridT, class Cells>
+static void astar_sequential(const GridT& grid, Cells& maze, node_t start, node_t end) {
+    BucketQueue open;
+    open.push(manhattan(grid, start, end), OpenEntry{start, 0});
+    bool found = false;
+    while (!open.empty()) {
+        OpenEntry entry = open.pop();
+        node_t node = entry.node;
+        if (maze.is_visited_solve(node)) continue;
+        maze.set_visited_solve(node);
+        if (node != start) maze.set_parent_dir(node, DIR_FROM_INDEX(entry.g_dir & 3));
+        if (node == end) {
+            found = true;
+            break;
+        }
+        node_t g = entry.g_dir >> 2;
+        grid.for_each_neighbour(node, [&](node_t child, int dir) {
+            if (maze.is_c(child) && !maze.is_visited_solve(child)) {
+                node_t child_g = g + cell_cost(maze, child);
+                open.push(child_g + manhattan(grid, child, end), OpenEntry{child, child_g << 2 | DIR_INDEX(OPPOSITE_DIR(dir))});
+            }
+            return false;
+        });
+    }
+
+    if (found) {
+        walk_parents(grid, maze, end, start, [&](node_t node) { maze.set_p(node); });
+    }
+}
+
+// Hash-distributed A* (HDA*, Kishimoto et al.): the cells are dealt out to the ranks round robin by id (node % ranks),
+// so the cells around the search front are spread evenly over the ranks whatever the shape of the maze
+// - A rank keeps the open list and the best g of its own cells, and sends every cell it generates to its owner
+// - The ranks expand a window of f values per round, like the buckets of delta-stepping (dijkstra.cpp): every entry
+//   with f below the smallest f anywhere + window, including the ones of its own cells it generates meanwhile, then the
+//   generated cells of other ranks are exchanged (MPI_Alltoallv). One round costs one MPI_Allreduce, MPI_Alltoall and
+//   MPI_Alltoallv, instead of one per value of f with cell costs of 1 to 256
+// - A cell may so be expanded before its g is final: it is opened again when a lower g arrives, the entries with a g
+//   above the best one are stale and dropped when they come out of the queue
+// - h is consistent, so no open f is below the cost of a path through it: the search stops once the smallest f anywhere
+//   is not below the best g of end, which is then the minimum cost
+// - The path is walked back by passing the current cell to the owner of the next one (point to point)
+template <class GridT, class Cells>
+static void astar_distributed(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end, int window) {
+    int rank, commSize;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &commSize);
+    auto owner = [&](node_t node) { return (int)(node % commSize); };
+    auto local = [&](node_t node) { return node / commSize; };
+
+    // A round pushes f up to window + MAX_CELL_COST + 1 above the smallest one
+    BucketQueue open(window + ASTAR_RING);
+    std::vector<node_t> best((grid.cells() + commSize - 1) / commSize, ASTAR_INFINITY);
+    // Lower the g of an owned cell and (re)open it
+    auto improve = [&](node_t node, node_t g_dir) {
+        node_t g = g_dir >> 2;
+        if (g < best[local(node)]) {
+            best[local(node)] = g;
+            if (node != start) maze.set_parent_dir(node, DIR_FROM_INDEX(g_dir & 3));
+            open.push(g + manhattan(grid, node, end), OpenEntry{node, g_dir});
+        }
+    };
+    if (owner(start) == rank) {
+        improve(start, 0);
+    }
+
+    std::vector<std::vector<node_t>> outgoing(commSize);
+    std::vector<int> send_counts(commSize), recv_counts(commSize), send_displs(commSize), recv_displs(commSize);
+    std::vector<node_t> send, received;
+    node_t end_g = ASTAR_INFINITY;
+    while (true) {
+        // Smallest f anywhere (stale entries included, it is still a lower bound) and the best g of end so far
+        long long state[2] = {open.empty() ? ASTAR_INFINITY : (long long)open.min_f(), owner(end) == rank ? (long long)best[local(end)] : ASTAR_INFINITY};
+        long long global[2];
+        MPI_Allreduce(state, global, 2, MPI_LONG_LONG, MPI_MIN, comm);
+        end_g = global[1];
+        if (global[0] == ASTAR_INFINITY || end_g <= global[0]) break; // end is unreachable, or its g is final
+
+        node_t limit = global[0] + window;
+        while (!open.empty() && open.min_f() < limit) {
+            OpenEntry entry = open.pop();
+            node_t node = entry.node;
+            node_t g = entry.g_dir >> 2;
+            if (g != best[local(node)] || node == end) continue; // Stale, or nothing to gain past end
+            maze.set_visited_solve(node);
+            grid.for_each_neighbour(node, [&](node_t child, int dir) {
+                if (maze.is_c(child)) {
+                    node_t child_g_dir = (g + cell_cost(maze, child)) << 2 | DIR_INDEX(OPPOSITE_DIR(dir));
+                    if (owner(child) == rank) {
+                        improve(child, child_g_dir);
+                    } else {
+                        outgoing[owner(child)].push_back(child);
+                        outgoing[owner(child)].push_back(child_g_dir);
+                    }
+                }
+                return false;
+            });
+        }
+
+        // Hand the generated cells to their owners
+        for (int r = 0; r < commSize; r++) {
+            send_counts[r] = outgoing[r].size();
+        }
+        MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, comm);
+        send_displs[0] = recv_displs[0] = 0;
+        for (int r = 1; r < commSize; r++) {
+            send_displs[r] = send_displs[r - 1] + send_counts[r - 1];
+            recv_displs[r] = recv_displs[r - 1] + recv_counts[r - 1];
+        }
+        send.resize(send_displs[commSize - 1] + send_counts[commSize - 1]);
+        for (int r = 0; r < commSize; r++) {
+            std::copy(outgoing[r].begin(), outgoing[r].end(), send.begin() + send_displs[r]);
+            outgoing[r].clear();
+        }
+        received.resize(recv_displs[commSize - 1] + recv_counts[commSize - 1]);
+        MPI_Alltoallv(send.data(), send_counts.data(), send_displs.data(), MPI_NODE_T, received.data(), recv_counts.data(), recv_displs.data(), MPI_NODE_T, comm);
+        for (size_t i = 0; i < received.size(); i += 2) {
+            improve(received[i], received[i + 1]);
+        }
+    }
+    if (owner(end) == rank && end_g != ASTAR_INFINITY) {
+        maze.set_visited_solve(end);
+    }
+
+    // Walk the path back from end, the cell goes to the owner of the next one; the rank reaching start tells everyone
+    std::vector<node_t> path;
+    if (end_g != ASTAR_INFINITY) {
+        const node_t DONE = -1;
+        node_t node = owner(end) == rank ? end : DONE;
+        while (true) {
+            if (node == DONE) {
+                MPI_Recv(&node, 1, MPI_NODE_T, MPI_ANY_SOURCE, ASTAR_PATH_TAG, comm, MPI_STATUS_IGNORE);
+                if (node == DONE) break;
+            }
+            node = walk_parents(grid, maze, node, start, [&](node_t n) { return owner(n) == rank; }, [&](node_t n) { path.push_back(n); });
+            if (node == start) {
+                for (int r = 0; r < commSize; r++) {
+                    if (r != rank) MPI_Send(&DONE, 1, MPI_NODE_T, r, ASTAR_PATH_TAG, comm);
+                }
+                break;
+            }
+            MPI_Send(&node, 1, MPI_NODE_T, owner(node), ASTAR_PATH_TAG, comm);
+            node = DONE;
+        }
+    }
+    share_path(maze, path, comm);
+}
+
+template <class GridT, class Cells>
+void solveUsingAStar(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end, int window) {
+    int commSize;
+    MPI_Comm_size(comm, &commSize);
+    if (commSize == 1) {
+        astar_sequential(grid, maze, start, end);
+    } else {
+        astar_distributed(grid, maze, comm, start, end, window);
+    }
+}
+
+#define INSTANTIATE_ASTAR(GridT, Cells) template void solveUsingAStar<GridT, Cells>(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end, int window);
+FOR_EACH_MAZE_TYPE(INSTANTIATE_ASTAR)
@@ -0,0 +1,11 @@
+#include <mpi.h>
+#include "defs.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
+
+// Minimum cost path from start to end with A* (same costs as dijkstra.hpp, Manhattan distance to end as heuristic)
+// One rank: sequential A* with a bucket queue. Several ranks: hash-distributed A* that expands the values of f below
+// the smallest one + window in each round (see astar.cpp, --delta sets the window)
+// The closed set is the VISITED_SOLVE bit, the path is marked P on every rank
+template <class GridT, class Cells>
+void solveUsingAStar(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end, int window);
@@ -0,0 +1,204 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <string.h>
+#include <omp.h>
+#include <vector>
+#include <algorithm>
+
+#include "batch.hpp"
+#include "pathindex.hpp"
+#include "junctions.hpp"
+#include "mpiutils.hpp"
+
+// Many start / end pairs on one maze (--queries)
+// - Every rank takes a contiguous slice of the queries (split_offset) and splits it again between its threads, the
+//   distances are gathered on rank 0 and written in query order
+// - lca: every rank builds the tree path index once (pathindex.hpp), then a query is a few dozen hops through it and
+//   the threads share the index read-only
+// - bfs: the queries are sorted by (start, end) so each distinct start is one level synchronous BFS that stops as soon
+//   as all the ends asked for it are reached. The ranks cut the sorted queries between two starts, so no BFS runs
+//   twice. Every thread keeps one scratch (visited and target bitmaps, frontiers) for all its BFS and only clears
+//   the bits it set, so a short query costs what it visits, not the size of the maze
+// - junction: every rank contracts the corridors once (junctions.hpp) with all the query cells as terminals, then a
+//   query is an A* on the junction graph, each thread with its own JunctionSearch
+
+// Reusable state of the BFS of one thread
+struct BfsScratch {
+    std::vector<uint64_t> visited, targets;
+    std::vector<node_t> frontier, next, touched;
+
+    BfsScratch(node_t cells) : visited((cells + 63) / 64, 0), targets((cells + 63) / 64, 0) {}
+
+    static bool get(const std::vector<uint64_t>& bits, node_t node) { return (bits[node >> 6] >> (node & 63)) & 1; }
+    static void set(std::vector<uint64_t>& bits, node_t node) { bits[node >> 6] |= (uint64_t)1 << (node & 63); }
+    static void clear(std::vector<uint64_t>& bits, node_t node) { bits[node >> 6] &= ~((uint64_t)1 << (node & 63)); }
+};
+
+// Answer the count queries of order that all start at the same cell with one BFS from it, out[i] is for order[i]
+template <class GridT, class Cells>
+static void answer_group(const GridT& grid, const Cells& maze, BfsScratch& scratch, const std::vector<node_t>& ends,
+                         const node_t* order, node_t count, node_t start, node_t* out) {
+    if (!maze.is_c(start)) {
+        return; // The distances stay -1
+    }
+    // The group is sorted by end, a target cell stands for the run of queries ending there
+    node_t remaining = 0;
+    for (node_t i = 0; i < count; i++) {
+        node_t end = ends[order[i]];
+        if (maze.is_c(end) && !BfsScratch::get(scratch.targets, end)) {
+            BfsScratch::set(scratch.targets, end);
+            remaining++;
+        }
+    }
+    auto reach = [&](node_t node, node_t level) {
+        if (!BfsScratch::get(scratch.targets, node)) return;
+        BfsScratch::clear(scratch.targets, node);
+        remaining--;
+        const node_t* run = std::lower_bound(order, order + count, node, [&](node_t q, node_t cell) { return ends[q] < cell; });
+        for (; run < order + count && ends[*run] == node; run++) {
+            out[run - order] = level;
+        }
+    };
+
+    scratch.frontier.assign(1, start);
+    scratch.touched.assign(1, start);
+    BfsScratch::set(scratch.visited, start);
+    reach(start, 0);
+    for (node_t level = 1; remaining > 0 && !scratch.frontier.empty(); level++) {
+        scratch.next.clear();
+        for (node_t node : scratch.frontier) {
+            grid.for_each_neighbour(node, [&](node_t child, int dir) {
+                if (maze.is_c(child) && !BfsScratch::get(scratch.visited, child)) {
+                    BfsScratch::set(scratch.visited, child);
+                    scratch.next.push_back(child);
+                    reach(child, level);
+                }
+                return false;
+            });
+        }
+        scratch.touched.insert(scratch.touched.end(), scratch.next.begin(), scratch.next.end());
+        scratch.frontier.swap(scratch.next);
+    }
+
+    // Leave the scratch clean for the next group: unset what was set, or wipe it all if that is cheaper
+    if ((node_t)scratch.touched.size() > (node_t)scratch.visited.size()) {
+        std::fill(scratch.visited.begin(), scratch.visited.end(), 0);
+    } else {
+        for (node_t node : scratch.touched) BfsScratch::clear(scratch.visited, node);
+    }
+    for (node_t i = 0; i < count; i++) {
+        BfsScratch::clear(scratch.targets, ends[order[i]]);
+    }
+}
+
+// Answer the groups of order between positions first and last (group boundaries), out[i] is for order[first + i]
+template <class GridT, class Cells>
+static void answer_with_bfs(const GridT& grid, const Cells& maze, const std::vector<node_t>& starts, const std::vector<node_t>& ends,
+                            const std::vector<node_t>& order, const std::vector<node_t>& groups, node_t first, node_t last, node_t* out) {
+    node_t g_first = std::lower_bound(groups.begin(), groups.end(), first) - groups.begin();
+    node_t g_last = std::lower_bound(groups.begin(), groups.end(), last) - groups.begin();
+    #pragma omp parallel
+    {
+        BfsScratch scratch(maze.count());
+        #pragma omp for schedule(dynamic, 1)
+        for (node_t g = g_first; g < g_last; g++) {
+            node_t begin = groups[g], count = groups[g + 1] - begin;
+            answer_group(grid, maze, scratch, ends, order.data() + begin, count, starts[order[begin]], out + (begin - first));
+        }
+    }
+}
+
+template <class GridT, class Cells>
+void solve_queries(const GridT& grid, const Cells& maze, const char* algorithm, MPI_Comm comm, node_t root,
+                   const std::vector<node_t>& starts, const std::vector<node_t>& ends, std::vector<node_t>& distances, BatchStats* stats) {
+    int rank, commSize;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &commSize);
+    node_t total = starts.size();
+    bool lca = strcmp(algorithm, "lca") == 0;
+    bool junction = strcmp(algorithm, "junction") == 0;
+
+    // Positions of the queries handled by each rank: lca and junction take them in file order, bfs sorts them by
+    // (start, end) and moves the split points to the next start so that every BFS runs on one rank only (all ranks sort
+    // the same way)
+    std::vector<node_t> order, groups; // groups: first position of every distinct start in order, then total
+    std::vector<node_t> bounds(commSize + 1);
+    for (int r = 0; r <= commSize; r++) {
+        bounds[r] = split_offset(total, r, commSize);
+    }
+    if (!lca && !junction) {
+        order.resize(total);
+        for (node_t i = 0; i < total; i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](node_t a, node_t b) {
+            return starts[a] != starts[b] ? starts[a] < starts[b] : ends[a] < ends[b];
+        });
+        for (node_t i = 0; i < total; i++) {
+            if (i == 0 || starts[order[i]] != starts[order[i - 1]]) groups.push_back(i);
+        }
+        groups.push_back(total);
+        for (int r = 0; r <= commSize; r++) {
+            bounds[r] = *std::lower_bound(groups.begin(), groups.end(), bounds[r]);
+        }
+    }
+    node_t first = bounds[rank], last = bounds[rank + 1];
+    std::vector<node_t> local(last - first, -1);
+
+    double t0 = MPI_Wtime(), t1;
+    if (lca) {
+        TreePathIndex<GridT> index(grid, maze, root);
+        if (index.loops() > 0) {
+            if (rank == 0)
+                fprintf(stderr, "Error: -s lca needs a perfect maze, this one has %lld loops (use -s bfs)\n", (long long)index.loops());
+            MPI_Abort(comm, 1);
+        }
+        t1 = MPI_Wtime();
+        #pragma omp parallel for schedule(static)
+        for (node_t i = first; i < last; i++) {
+            local[i - first] = index.distance(starts[i], ends[i]);
+        }
+    } else if (junction) {
+        // Only this rank's query cells need to be junctions
+        std::vector<node_t> terminals(starts.begin() + first, starts.begin() + last);
+        terminals.insert(terminals.end(), ends.begin() + first, ends.begin() + last);
+        JunctionGraph<GridT> graph(grid, maze, terminals);
+        t1 = MPI_Wtime();
+        #pragma omp parallel
+        {
+            JunctionSearch<GridT> search(grid, graph);
+            #pragma omp for schedule(dynamic, 16)
+            for (node_t i = first; i < last; i++) {
+                local[i - first] = search.distance(starts[i], ends[i]);
+            }
+        }
+    } else {
+        t1 = MPI_Wtime();
+        answer_with_bfs(grid, maze, starts, ends, order, groups, first, last, local.data());
+    }
+    double t2 = MPI_Wtime();
+    if (stats != nullptr) {
+        stats->prepare_s = t1 - t0;
+        stats->query_s = t2 - t1;
+        stats->answered = last - first;
+    }
+
+    // The ranks hold consecutive positions, rank 0 puts the bfs answers back in query order
+    std::vector<int> counts(commSize), displs(commSize);
+    for (int r = 0; r < commSize; r++) {
+        displs[r] = bounds[r];
+        counts[r] = bounds[r + 1] - bounds[r];
+    }
+    std::vector<node_t> gathered(rank == 0 ? total : 0);
+    MPI_Gatherv(local.data(), local.size(), MPI_NODE_T, gathered.data(), counts.data(), displs.data(), MPI_NODE_T, 0, comm);
+    if (rank == 0) {
+        if (lca || junction) {
+            distances.swap(gathered);
+        } else {
+            distances.assign(total, -1);
+            for (node_t i = 0; i < total; i++) distances[order[i]] = gathered[i];
+        }
+    }
+}
+
+#define INSTANTIATE_BATCH(GridT, Cells) template void solve_queries<GridT, Cells>(const GridT& grid, const Cells& maze, const char* algorithm, MPI_Comm comm, node_t root, \
+    const std::vector<node_t>& starts, const std::vector<node_t>& ends, std::vector<node_t>& distances, BatchStats* stats);
+FOR_EACH_MAZE_TYPE(INSTANTIATE_BATCH)
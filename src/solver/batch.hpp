@@ -0,0 +1,21 @@
+#include <mpi.h>
+#include <vector>
+#include "defs.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
+
+// Timings of a batch, per rank
+struct BatchStats {
+    double prepare_s; // Building the shared structures (the path index for lca, the junction graph for junction)
+    double query_s; // Answering this rank's queries
+    node_t answered; // Queries of this rank
+};
+
+// Distances in steps from starts[i] to ends[i] for all the queries (see batch.cpp), -1 where there is no path
+// The queries are split between the ranks and the OpenMP threads of each rank, distances is filled on rank 0
+// - lca: tree path index rooted at root (perfect mazes only), O(log cells) per query
+// - bfs: one BFS per distinct start answers all the queries sharing it, any maze
+// - junction: A* per query on the maze with its corridors contracted (junctions.hpp), any maze
+template <class GridT, class Cells>
+void solve_queries(const GridT& grid, const Cells& maze, const char* algorithm, MPI_Comm comm, node_t root,
+                   const std::vector<node_t>& starts, const std::vector<node_t>& ends, std::vector<node_t>& distances, BatchStats* stats);
@@ -0,0 +1,189 @@
+#include <mpi.h>
+#include <vector>
+
+#include "bibfs.hpp"
+#include "mpiutils.hpp"
+
+// Bidirectional BFS: one level synchronous BFS from start and one from end, until their visited sets meet
+// - The communicator is split in two groups (MPI_Comm_split), the first half of the ranks searches from start and the
+//   second half from end, both at the same time. Inside a group the frontier is split between the ranks and the cells
+//   they discover are merged everywhere (MPI_Allgatherv, in rank order so every rank keeps the same parents)
+// - After every level the group leaders swap their new frontiers (periodic exchange) and broadcast them in their group,
+//   so every rank also knows which cells the other side has visited
+// - With both sides at depth k, the first level where a new frontier touches the other side's visited cells holds the
+//   shortest path, of length 2k - 1 if a new cell was discovered by the other side at level k - 1, 2k if at level k
+//   (never earlier, or a parent of the cell would have met it a level before). Each side keeps the parity of the level
+//   it discovered a cell at, so the test is one bit per frontier cell. The meeting cell is the smallest such id, so both
+//   groups pick the same one without talking
+// - Each side walks its half of the path from the meeting cell with its parents, the halves are stitched on every rank
+// - A rank's VISITED_SOLVE bits are the cells it expanded, the side's own visited bits and parents are kept apart
+//   (both sides live in the same process when there is a single rank)
+
+// State of the search from one end
+struct SearchSide {
+    // Visited cells (PLANE_VISITED_SOLVE), the ones discovered at an odd level (PLANE_PATH) and, for a side searched
+    // here, their parents (PLANE_PARENT)
+    BitplaneCells marks;
+    std::vector<node_t> frontier; // Cells discovered by the last level
+    int level = 0; // Level of the frontier
+
+    void begin(node_t node) {
+        marks.set_visited_solve(node);
+        frontier.assign(1, node);
+    }
+    // Mark a cell discovered by the level being expanded
+    void discover(node_t node) {
+        marks.set_visited_solve(node);
+        if ((level + 1) & 1) marks.set_p(node);
+    }
+    bool odd(node_t node) const { return marks.is_p(node); }
+    void next_level(std::vector<node_t>& discovered) {
+        frontier.swap(discovered);
+        level++;
+    }
+};
+
+// Expand one level of side with the ranks of group
+template <class GridT, class Cells>
+static void expand_level(const GridT& grid, Cells& maze, SearchSide& side, MPI_Comm group) {
+    int rank, size;
+    MPI_Comm_rank(group, &rank);
+    MPI_Comm_size(group, &size);
+
+    // Own slice of the frontier, children packed as child << 2 | DIR_INDEX(direction of the parent)
+    std::vector<node_t> local;
+    node_t first = split_offset(side.frontier.size(), rank, size);
+    node_t last = split_offset(side.frontier.size(), rank + 1, size);
+    for (node_t i = first; i < last; i++) {
+        node_t node = side.frontier[i];
+        maze.set_visited_solve(node);
+        grid.for_each_neighbour(node, [&](node_t child, int dir) {
+            if (maze.is_c(child) && !side.marks.is_visited_solve(child)) {
+                local.push_back(child << 2 | DIR_INDEX(OPPOSITE_DIR(dir)));
+            }
+            return false;
+        });
+    }
+
+    std::vector<node_t> all;
+    if (size > 1) {
+        int count = local.size();
+        std::vector<int> counts(size), displs(size, 0);
+        MPI_Allgather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, group);
+        for (int r = 1; r < size; r++) {
+            displs[r] = displs[r - 1] + counts[r - 1];
+        }
+        all.resize(displs[size - 1] + counts[size - 1]);
+        MPI_Allgatherv(local.data(), count, MPI_NODE_T, all.data(), counts.data(), displs.data(), MPI_NODE_T, group);
+    } else {
+        all.swap(local);
+    }
+
+    // First claim wins
+    std::vector<node_t> discovered;
+    for (node_t packed : all) {
+        node_t child = packed >> 2;
+        if (!side.marks.is_visited_solve(child)) {
+            side.discover(child);
+            side.marks.set_parent_dir(child, DIR_FROM_INDEX(packed & 3));
+            discovered.push_back(child);
+        }
+    }
+    side.next_level(discovered);
+}
+
+// Learn the new frontier of the other side: the leaders swap theirs and broadcast what they got in their group
+static void exchange_frontiers(SearchSide& mine, SearchSide& other, int other_leader, MPI_Comm comm, MPI_Comm group) {
+    int group_rank;
+    MPI_Comm_rank(group, &group_rank);
+    long long count = 0;
+    if (group_rank == 0) {
+        long long mine_count = mine.frontier.size();
+        MPI_Sendrecv(&mine_count, 1, MPI_LONG_LONG, other_leader, 0, &count, 1, MPI_LONG_LONG, other_leader, 0, comm, MPI_STATUS_IGNORE);
+    }
+    MPI_Bcast(&count, 1, MPI_LONG_LONG, 0, group);
+    std::vector<node_t> discovered(count);
+    if (group_rank == 0) {
+        MPI_Sendrecv(mine.frontier.data(), mine.frontier.size(), MPI_NODE_T, other_leader, 1, discovered.data(), count, MPI_NODE_T, other_leader, 1, comm, MPI_STATUS_IGNORE);
+    }
+    MPI_Bcast(discovered.data(), count, MPI_NODE_T, 0, group);
+    for (node_t node : discovered) {
+        other.discover(node);
+    }
+    other.next_level(discovered);
+}
+
+// The meeting cell after a level, -1 if the sides don't touch yet
+static node_t find_meeting(const SearchSide sides[2]) {
+    node_t odd = -1, even = -1; // Best cell on a path of length 2k - 1 / 2k
+    for (int s = 0; s < 2; s++) {
+        const SearchSide& other = sides[1 - s];
+        for (node_t node : sides[s].frontier) {
+            if (!other.marks.is_visited_solve(node)) continue;
+            // Both sides are at level k, the other one found node at level k - 1 or k
+            if (other.odd(node) != sides[s].odd(node)) {
+                if (odd == -1 || node < odd) odd = node;
+            } else {
+                if (even == -1 || node < even) even = node;
+            }
+        }
+    }
+    return odd != -1 ? odd : even;
+}
+
+template <class GridT, class Cells>
+void solveUsingBidirectionalBFS(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end) {
+    int rank, commSize;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &commSize);
+
+    // Side 0 searches from start, side 1 from end
+    int start_ranks = (commSize + 1) / 2;
+    int mine = commSize == 1 ? -1 : (rank < start_ranks ? 0 : 1); // -1: both
+    MPI_Comm group;
+    MPI_Comm_split(comm, mine == 1, rank, &group);
+    int group_rank;
+    MPI_Comm_rank(group, &group_rank);
+
+    SearchSide sides[2];
+    for (int s = 0; s < 2; s++) {
+        bool searched_here = mine == -1 || mine == s;
+        sides[s].marks = BitplaneCells(grid.cells(), PLANE_VISITED_SOLVE | PLANE_PATH | (searched_here ? PLANE_PARENT : 0));
+    }
+    sides[0].begin(start);
+    sides[1].begin(end);
+
+    node_t meeting = start == end ? start : -1;
+    while (meeting == -1) {
+        if (mine == -1) {
+            expand_level(grid, maze, sides[0], group);
+            expand_level(grid, maze, sides[1], group);
+        } else {
+            expand_level(grid, maze, sides[mine], group);
+            exchange_frontiers(sides[mine], sides[1 - mine], mine == 0 ? start_ranks : 0, comm, group);
+        }
+        meeting = find_meeting(sides);
+        if (meeting == -1 && (sides[0].frontier.empty() || sides[1].frontier.empty())) {
+            break; // end is not reachable
+        }
+    }
+
+    // Stitch the halves: start side from the meeting cell back to start (exclusive), end side from there to end
+    std::vector<node_t> path;
+    if (meeting != -1 && group_rank == 0) {
+        if (mine != 1) {
+            walk_parents(grid, sides[0].marks, meeting, start, [&](node_t node) { path.push_back(node); });
+        }
+        if (mine != 0) {
+            for (node_t node = meeting; node != end; ) {
+                node = grid.step(node, sides[1].marks.parent_dir(node));
+                path.push_back(node);
+            }
+        }
+    }
+    share_path(maze, path, comm);
+    MPI_Comm_free(&group);
+}
+
+#define INSTANTIATE_BIBFS(GridT, Cells) template void solveUsingBidirectionalBFS<GridT, Cells>(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end);
+FOR_EACH_MAZE_TYPE(INSTANTIATE_BIBFS)
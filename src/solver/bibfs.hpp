@@ -0,0 +1,9 @@
+#include <mpi.h>
+#include "defs.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
+
+// Shortest path (in steps) from start to end with a BFS from both ends at once (see bibfs.cpp)
+// The ranks are split in a start-side and an end-side group, one rank runs both sides; the path is marked P everywhere
+template <class GridT, class Cells>
+void solveUsingBidirectionalBFS(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end);
@@ -1,54 +1,34 @@
 #include <mpi.h>
 #include <vector>
-#include <queue>
-#include <set>
-#include <unordered_map>
-#include <random>
-#include <algorithm>
-#include <cstddef>
 #include "dfs.hpp"
+#include "mpiutils.hpp"
 
 // - Nodes of the maze are represented by an integer, 64*row + col
 // - We make macros to access row no. and col no., neighbors, etc.
 // - make sure that the neighbors macros give valid output, i.e. they don't go out of bounds
 // - Also need a check whether a node is valid or not
-// - We can store edges as 64x64 1d array of short (16bit) where last 4 bits value representing whether node is connected to left/right/down/up neighbors
-// - the last 8 bits - | visited_by_solver | in_path | not_walled | visited | left | right | up | down | 
-
-void print_visited_solve2(short* edges, int size){
-    // printf("Printing visited\n");
-    for (int i = 0; i < size; i++){
-        for (int j = 0; j < size; j++){
-            if (IS_VISITED_SOLVE(edges[i * size + j])){
-                printf("V");
-            } else {
-                printf("X");
-            }
-        }
-        printf("\n");
-    }
-}
+// - The maze is stored in a cell type from cells.hpp, the solver uses the C, visited_by_solver, P and parent direction fields
 
-// Function to generate a maze using BFS and MPI
-// @param size: The size of the maze
-// @param maze: The array of nodes of the maze, each last 8bits is | 0 | 0 | selected | visited | left | right | up | down |
-void solveUsingDFS(int size, short* maze, MPI_Comm comm, int start, int end){
+// Function to solve a maze using BFS + DFS and MPI
+// @param grid: The topology of the maze (see grid.hpp)
+// @param maze: The cells of the maze
+template <class GridT, class Cells>
+void solveUsingDFS(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end){
     // Get the rank and size of the communicator
     int rank, commSize;
     MPI_Comm_rank(comm, &rank);
     MPI_Comm_size(comm, &commSize);
 
     // define the frontier and visited set
-    std::vector<int> global_frontier;
+    std::vector<node_t> global_frontier;
 
     // For each process
-    std::vector<int> next_global_frontier; // next frontier for each process
-    // We would also need to maintain a list/vector of local_neighbours_paired added (along with with neighbour they are) so that the final maze matrix can be updated before next loop
-    std::unordered_map<int, int> parents; // key: neighbour_node, value: node from which it was added. Maps the child to the parent
+    std::vector<node_t> next_global_frontier; // next frontier for each process
+    // The parent of every discovered node is kept as a direction in the maze cells (towards the node from which it was added)
 
 
     global_frontier.push_back(start);
-    SET_VISITED_SOLVE(maze[start]);
+    maze.set_visited_solve(start);
 
     // This loop does BFS until we get frontier of size >= commSize, 
     // then we split the frontier nodes among the procs and they do local DFS
@@ -63,119 +43,112 @@ void solveUsingDFS(int size, short* maze, MPI_Comm comm, int start, int end){
         next_global_frontier.clear();
 
         // For each node in the local frontier, add the neighbors to the next local frontier if they are not visited
-        for (int parent : global_frontier) {
+        for (node_t parent : global_frontier) {
 
-            int child;
             // Add the neighbors to the next local frontier if they are not visited and not marked as C
-            if ((child = LEFT_NODE(parent, size)) != -1 && !IS_VISITED_SOLVE(maze[child]) && IS_C(maze[child])) {
-                next_global_frontier.push_back(child);
-                parents[child] = parent;
-                SET_VISITED_SOLVE(maze[child]);
-            }
-            if ((child = RIGHT_NODE(parent, size)) != -1 && !IS_VISITED_SOLVE(maze[child]) && IS_C(maze[child])) {
-                next_global_frontier.push_back(child);
-                parents[child] = parent;
-                SET_VISITED_SOLVE(maze[child]);
-            }
-            if ((child = UP_NODE(parent, size)) != -1 && !IS_VISITED_SOLVE(maze[child]) && IS_C(maze[child])) {
-                next_global_frontier.push_back(child);
-                parents[child] = parent;
-                SET_VISITED_SOLVE(maze[child]);
-            }
-            if ((child = DOWN_NODE(parent, size)) != -1 && !IS_VISITED_SOLVE(maze[child]) && IS_C(maze[child])) {
-                next_global_frontier.push_back(child);
-                parents[child] = parent;
-                SET_VISITED_SOLVE(maze[child]);
-            }
+            grid.for_each_neighbour(parent, [&](node_t child, int dir) {
+                if (!maze.is_visited_solve(child) && maze.is_c(child)) {
+                    next_global_frontier.push_back(child);
+                    maze.set_parent_dir(child, OPPOSITE_DIR(dir)); // the parent is on the other side
+                    maze.set_visited_solve(child);
+                }
+                return false;
+            });
         }
 
         // Update the global frontier
         global_frontier = next_global_frontier;
     }
 
-    std::vector<int> local_frontier; // current frontier for each process
-    int local_frontier_size = global_frontier.size() / commSize + (rank < (int)(global_frontier.size() % commSize) ? 1 : 0);
-    for (int i = 0; i < local_frontier_size; i++){
-        local_frontier.push_back(global_frontier[i + rank * local_frontier_size]);
+    // The BFS levels are the same on every rank, so if they reached the end (or ran out of cells) no rank has to search
+    if (maze.is_visited_solve(end) || global_frontier.empty()) {
+        if (maze.is_visited_solve(end)) {
+            walk_parents(grid, maze, end, start, [&](node_t node) { maze.set_p(node); });
+        }
+        return;
     }
-    
-    // Could sync here but not necessary
-
-    bool found = false;
-    // DFS loop
-    for (int node : local_frontier){
-        std::vector<int> stack;
-        stack.push_back(node);
-        while (true) {
+
+    // Each rank takes a contiguous slice of the frontier and runs a DFS from each of its nodes in turn
+    node_t first = split_offset(global_frontier.size(), rank, commSize);
+    node_t last = split_offset(global_frontier.size(), rank + 1, commSize);
+    node_t next_root = first;
+    std::vector<node_t> stack;
+    bool found = false, exhausted = false;
+
+    // Expand at most budget nodes of the DFS, stops early once the end is on top of the stack or the slice is done
+    auto expand = [&](long budget) {
+        while (budget-- > 0) {
             if (stack.empty()) {
-                break;
+                if (next_root == last) {
+                    exhausted = true;
+                    return;
+                }
+                stack.push_back(global_frontier[next_root++]);
             }
-            if (stack.back() == end){
+            if (stack.back() == end) {
                 found = true;
-                break;
-            }   
-
-            // Get the last element of the stack
-            int current_node = stack.back();
-
-            // For each of the 4 neighbors of the current node
-            int child;
-            if ((child = LEFT_NODE(current_node, size)) != -1 && !IS_VISITED_SOLVE(maze[child]) && IS_C(maze[child])) {
-                stack.push_back(child);
-                parents[child] = current_node;
-                SET_VISITED_SOLVE(maze[child]);
-                continue;
+                return;
             }
-            if ((child = RIGHT_NODE(current_node, size)) != -1 && !IS_VISITED_SOLVE(maze[child]) && IS_C(maze[child])) {
-                stack.push_back(child);
-                parents[child] = current_node;
-                SET_VISITED_SOLVE(maze[child]);
-                continue;
+
+            // Go down the first neighbour that is not visited, or backtrack
+            bool pushed = grid.for_each_neighbour(stack.back(), [&](node_t child, int dir) {
+                if (!maze.is_visited_solve(child) && maze.is_c(child)) {
+                    stack.push_back(child);
+                    maze.set_parent_dir(child, OPPOSITE_DIR(dir));
+                    maze.set_visited_solve(child);
+                    return true;
+                }
+                return false;
+            });
+            if (!pushed)
+                stack.pop_back();
+        }
+    };
+
+    // Termination: between rounds of DFS_POLL_INTERVAL expansions the ranks run nonblocking MIN-reductions of (lowest
+    // rank that found the end, whether every rank is done), one at a time. A rank still searching only tests the
+    // pending reduction and carries on, a rank that is done waits for it. All ranks see the same results, so they stop
+    // after the same reduction: the first one started after the end was found (or after every rank ran out of nodes)
+    int found_rank = commSize;
+    int state[2], global[2];
+    MPI_Request request = MPI_REQUEST_NULL;
+    while (true) {
+        bool searching = !found && !exhausted;
+        if (searching) {
+            expand(DFS_POLL_INTERVAL);
+        }
+        if (request != MPI_REQUEST_NULL) {
+            int complete = 1;
+            if (searching) {
+                MPI_Test(&request, &complete, MPI_STATUS_IGNORE);
+            } else {
+                MPI_Wait(&request, MPI_STATUS_IGNORE);
             }
-            if ((child = UP_NODE(current_node, size)) != -1 && !IS_VISITED_SOLVE(maze[child]) && IS_C(maze[child])) {
-                stack.push_back(child);
-                parents[child] = current_node;
-                SET_VISITED_SOLVE(maze[child]);
+            if (!complete) {
                 continue;
             }
-            if ((child = DOWN_NODE(current_node, size)) != -1 && !IS_VISITED_SOLVE(maze[child]) && IS_C(maze[child])) {
-                stack.push_back(child);
-                parents[child] = current_node;
-                SET_VISITED_SOLVE(maze[child]);
-                continue;
+            if (global[0] < commSize || global[1] == 1) {
+                found_rank = global[0];
+                break;
             }
-            stack.pop_back();
         }
-        if (found)
-            break;
+        state[0] = found ? rank : commSize;
+        state[1] = found || exhausted;
+        MPI_Iallreduce(state, global, 2, MPI_INT, MPI_MIN, comm, &request);
     }
 
-    //? Maybe should give a signal to other procs to give up once any proc finds the end?
+    if (found_rank == commSize) {
+        return; // end is not reachable
+    }
 
-    int found_rank;
-    if (found){
-        // If found, update the PATH flags in maze
-        int end_node = end;
-        while (end_node != start){
-            SET_P(maze[end_node]);
-            end_node = parents[end_node];
-        }
-        found_rank = rank;
-        // send found_rank to rank 0
-        // if 0 found it, no need to send
-        if (rank != 0)
-            MPI_Send(&found_rank, 1, MPI_INT, 0, 0, comm);
-    } else {
-        // if not found, and rank 0, receive from the proc that found it
-        if (rank == 0){
-            MPI_Status status;
-            MPI_Recv(&found_rank, 1, MPI_INT, MPI_ANY_SOURCE, 0, comm, &status);
-        }
+    // The rank that found the end walks the path and hands its cells to everyone, the other ranks keep their own
+    // VISITED_SOLVE bits and parents (a broadcast of the cells would overwrite them all with packed cells)
+    std::vector<node_t> path;
+    if (rank == found_rank) {
+        walk_parents(grid, maze, end, start, [&](node_t node) { path.push_back(node); });
     }
+    share_path(maze, path, comm);
+}
 
-    // Broadcast the found_rank from 0
-    MPI_Bcast(&found_rank, 1, MPI_INT, 0, comm);
-   
-    // broadcast the maze from the proc that found the end
-    MPI_Bcast(maze, size * size, MPI_SHORT, found_rank, comm);
-}
\ No newline at end of file
+#define INSTANTIATE_DFS(GridT, Cells) template void solveUsingDFS<GridT, Cells>(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end);
+FOR_EACH_MAZE_TYPE(INSTANTIATE_DFS)
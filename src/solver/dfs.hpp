@@ -1,3 +1,12 @@
 #include <mpi.h>
 #include "defs.hpp"
-void solveUsingDFS(int size, short* maze, MPI_Comm comm, int start, int end);
\ No newline at end of file
+#include "cells.hpp"
+#include "grid.hpp"
+
+// Number of DFS expansions between two termination checks of solveUsingDFS. After another rank found the end, a rank
+// still searching stops a few poll intervals later: the rounds while the pending reduction completes, then the rounds
+// while the next one waits for every rank's next poll (MPI_Test only progresses it between rounds)
+#define DFS_POLL_INTERVAL 4096
+
+template <class GridT, class Cells>
+void solveUsingDFS(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end);
@@ -1,308 +1,166 @@
 #include <mpi.h>
 #include <vector>
-#include <queue>
-#include <set>
-#include <unordered_map>
-#include <random>
 #include <algorithm>
-#include <cstddef>
 
 #include "dijkstra.hpp"
+#include "mpiutils.hpp"
+
+// Weighted shortest path with delta-stepping (Meyer & Sanders, "Delta-stepping: a parallelizable shortest path algorithm")
+// - Entering a C cell costs 1 + its weight (the node weights kept in the maze by expand_edges_to_maze, 0 for the cells
+//   between nodes and for mazes without weights), walls are never entered
+// - Tentative distances are kept in buckets of width delta. The lowest non-empty bucket is emptied by relaxing the light
+//   edges (cost <= delta) of its cells until no cell falls back into it, then the heavy edges of all the cells it
+//   settled are relaxed once. delta = 1 is Dijkstra with a bucket queue, delta >= 256 is Bellman-Ford on a moving window
+// - Every rank owns a contiguous block of node ids and keeps the distances of its own cells only; a relaxation of a
+//   cell owned by another rank is sent to it (MPI_Alltoallv) once per phase
+// - An edge never costs more than 256, so the live buckets fit in a ring of 256 / delta + 2
+// - The search stops once the bucket being emptied starts past the distance of end
+
+#define DIST_INFINITY INT64_MAX
+
+// Send every rank the relaxations (cell, distance << 2 | parent direction index) of the cells it owns, returns the ones
+// received from all ranks
+static std::vector<node_t> exchange_relaxations(std::vector<std::vector<node_t>>& outgoing, MPI_Comm comm){
+    int size;
+    MPI_Comm_size(comm, &size);
+    std::vector<int> send_counts(size), recv_counts(size), send_displs(size, 0), recv_displs(size, 0);
+    for (int r = 0; r < size; r++){
+        send_counts[r] = outgoing[r].size();
+    }
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, comm);
+    for (int r = 1; r < size; r++){
+        send_displs[r] = send_displs[r - 1] + send_counts[r - 1];
+        recv_displs[r] = recv_displs[r - 1] + recv_counts[r - 1];
+    }
+    std::vector<node_t> send(send_displs[size - 1] + send_counts[size - 1]);
+    for (int r = 0; r < size; r++){
+        std::copy(outgoing[r].begin(), outgoing[r].end(), send.begin() + send_displs[r]);
+        outgoing[r].clear();
+    }
+    std::vector<node_t> received(recv_displs[size - 1] + recv_counts[size - 1]);
+    MPI_Alltoallv(send.data(), send_counts.data(), send_displs.data(), MPI_NODE_T, received.data(), recv_counts.data(), recv_displs.data(), MPI_NODE_T, comm);
+    return received;
+}
 
-void solveUsingDijkstra(int size, short* maze, MPI_Comm comm, int start, int end){
-    // 
-    // printf("Solving using Dijkstra\n");
-    // Get the rank and size of the communicator
+template <class GridT, class Cells>
+void solveUsingDijkstra(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end, int delta){
     int rank, commSize;
-    int found_rank;
     MPI_Comm_rank(comm, &rank);
     MPI_Comm_size(comm, &commSize);
 
-    // define the frontier and visited set
-    std::vector<int> global_frontier;
-
-    // For each process
-    std::vector<int> local_frontier; // current frontier for each process
-    std::vector<int> next_local_frontier; // next frontier for each process
-    // We would also need to maintain a list/vector of local_neighbours_paired added (along with with neighbour they are) so that the final maze matrix can be updated before next loop
-    std::unordered_map<int, int> local_neighbours; // key: neighbour_node, value: node from which it was added
-    std::unordered_map<int, int> parent_map;
-
-
-    // if rank is 0, add the start node to the frontier
-    if (rank == 0){
-        global_frontier.push_back(start);
-    }
-
-    // Broadcast the size of the global frontier
-    int global_frontier_size;
-    if (rank == 0)
-        global_frontier_size = global_frontier.size();
-    MPI_Bcast(&global_frontier_size, 1, MPI_INT, 0, comm);
-
-    // Resize the global_frontier vector on non-root processes
-    if (rank != 0) {
-        global_frontier.resize(global_frontier_size);
-    }
-
-    // Broadcast the global frontier data
-    MPI_Bcast(global_frontier.data(), global_frontier_size, MPI_INT, 0, comm);
-    bool found = false;
-    while (true){
-        
-
-        // printing the tree generated step by step
-        // if (rank == 0){
-        //     print_maze_visual(maze, size);
-        //     printf("\n");
-        // }
-        
-        // If the global frontier is empty, break
-        if (global_frontier.size() == 0){
-            break;
-        }
-
-        // Set the visted bit of the nodes in the global frontier
-        for (int node : global_frontier){
-            SET_VISITED_SOLVE(maze[node]);
-        }
-        
-        if (IS_VISITED_SOLVE(maze[end])){
-            found = true;
-            break;
+    // This rank's block of node ids
+    node_t chunk = (grid.cells() + commSize - 1) / commSize;
+    node_t first = std::min<node_t>(grid.cells(), rank * chunk);
+    node_t last = std::min<node_t>(grid.cells(), first + chunk);
+    auto owner = [&](node_t node) { return (int)(node / chunk); };
+    auto cost = [&](node_t node) { return cell_cost(maze, node); };
+
+    std::vector<node_t> dist(last - first, DIST_INFINITY);
+    int ring = MAX_CELL_COST / delta + 2;
+    std::vector<std::vector<node_t>> buckets(ring);
+    node_t queued = 0; // Entries in the ring, stale ones included
+
+    // Lower the distance of an owned cell, (re)filing it in its bucket (the old entry goes stale)
+    auto improve = [&](node_t node, node_t d, int parent_dir) {
+        if (d < dist[node - first]){
+            dist[node - first] = d;
+            maze.set_parent_dir(node, parent_dir);
+            buckets[(d / delta) % ring].push_back(node);
+            queued++;
         }
-
-        // Clear the next local frontier
-        local_frontier.clear();
-        next_local_frontier.clear();
-
-        // Split the global frontier into local frontiers per proc
-        int local_frontier_size = global_frontier.size() / commSize + (rank < (int)(global_frontier.size() % commSize) ? 1 : 0);
-        for (int i = 0; i < local_frontier_size; i++){
-            local_frontier.push_back(global_frontier[i + rank * local_frontier_size]);
-        }
-
-        // For each node in the local frontier, add the neighbors to the next local frontier if they are not visited
-        // Set them as visited for current proc (we dont want to check the nodes again in case they are a neighbour of another node in the local frontier)
-
-        for (int parent : local_frontier) {
-
-            int child;
-            // Add the neighbors to the next local frontier if they are not visited
-            if ((child = LEFT_NODE(parent, size)) != -1 && !IS_VISITED_SOLVE(maze[child])) {
-                if (child == end) found_rank = rank;
-                next_local_frontier.push_back(child);
-                local_neighbours[child] = parent;
-                SET_VISITED_SOLVE(maze[child]);
-            }
-            if ((child = RIGHT_NODE(parent, size)) != -1 && !IS_VISITED_SOLVE(maze[child])) {
-                if (child == end) found_rank = rank;
-                next_local_frontier.push_back(child);
-                local_neighbours[child] = parent;
-                SET_VISITED_SOLVE(maze[child]);
-            }
-            if ((child = UP_NODE(parent, size)) != -1 && !IS_VISITED_SOLVE(maze[child])) {
-                if (child == end) found_rank = rank;
-                next_local_frontier.push_back(child);
-                local_neighbours[child] = parent;
-                SET_VISITED_SOLVE(maze[child]);
-            }
-            if ((child = DOWN_NODE(parent, size)) != -1 && !IS_VISITED_SOLVE(maze[child])) {
-                if (child == end) found_rank = rank;
-                next_local_frontier.push_back(child);
-                local_neighbours[child] = parent;
-                SET_VISITED_SOLVE(maze[child]);
+    };
+    std::vector<std::vector<node_t>> outgoing(commSize);
+    auto relax = [&](node_t node, bool light) {
+        node_t d = dist[node - first];
+        grid.for_each_neighbour(node, [&](node_t child, int dir) {
+            if (maze.is_c(child) && (cost(child) <= delta) == light){
+                if (owner(child) == rank){
+                    improve(child, d + cost(child), OPPOSITE_DIR(dir));
+                } else {
+                    outgoing[owner(child)].push_back(child);
+                    outgoing[owner(child)].push_back((d + cost(child)) << 2 | DIR_INDEX(OPPOSITE_DIR(dir)));
+                }
             }
+            return false;
+        });
+    };
+    auto deliver = [&]() {
+        std::vector<node_t> received = exchange_relaxations(outgoing, comm);
+        for (size_t i = 0; i < received.size(); i += 2){
+            improve(received[i], received[i + 1] >> 2, DIR_FROM_INDEX(received[i + 1] & 3));
         }
+    };
 
-        // Clear the global frontier
-        global_frontier.clear();
-
-        // Next part is to merge the next local frontiers of each proc into the global frontier
-        if (rank == 0) {
-            // Make a set instead of vector (to avoid duplicates)
-            std::set<int> global_frontier_temp;
-
-            // Insert the next local frontier of proc 0
-            global_frontier_temp.insert(next_local_frontier.begin(), next_local_frontier.end());
-            
-            // Receive the next local frontiers of other processes and insert them into the set
-            for (int i = 1; i < commSize; i++) {
-
-            // receive the size of the message to receive next
-            int temp_size;
-            MPI_Recv(&temp_size, 1, MPI_INT, i, 0, comm, MPI_STATUS_IGNORE);
-            
-            // receive the next_local_frontier of each process
-            std::vector<int> temp(temp_size);
-            MPI_Recv(temp.data(), temp_size, MPI_INT, i, 0, comm, MPI_STATUS_IGNORE);
+    if (owner(start) == rank){
+        dist[start - first] = 0;
+        buckets[0].push_back(start);
+        queued++;
+    }
 
-            // insert to global_frontier_temp set to avoid duplicates
-            global_frontier_temp.insert(temp.begin(), temp.end());
+    node_t current = 0; // Index of the bucket being emptied
+    std::vector<node_t> settled; // Cells taken from the current bucket, their heavy edges are relaxed at the end
+    node_t end_dist = DIST_INFINITY;
+    while (true){
+        // Next non-empty bucket anywhere, and the distance of end so far
+        long long local[2] = {DIST_INFINITY, owner(end) == rank ? (long long)dist[end - first] : DIST_INFINITY};
+        for (node_t b = current; queued > 0 && b < current + ring; b++){
+            if (!buckets[b % ring].empty()){
+                local[0] = b;
+                break;
             }
-
-            // Convert the set to vector
-            global_frontier.assign(global_frontier_temp.begin(), global_frontier_temp.end());
-            std::random_shuffle(global_frontier.begin(), global_frontier.end());
-
-            // Combine and broadcast the local_neighbours hashmap
-            // std::unordered_map<int, int> combined_parents;
-            // combined_parents.insert(local_neighbours.begin(), local_neighbours.end());
-            // MPI_Bcast(&combined_parents, 1, MPI_INT, 0, comm);
-
-        } else {
-            // for other processes
-            int next_local_frontier_size = next_local_frontier.size();
-            // send size of message
-            MPI_Send(&next_local_frontier_size, 1, MPI_INT, 0, 0, comm);
-            // send the next_local_frontier
-            MPI_Send(next_local_frontier.data(), next_local_frontier_size, MPI_INT, 0, 0, comm);
-
-            // send the local_neighbours hashmap
-            // MPI_Bcast(&local_neighbours, 1, MPI_INT, 0, comm);
         }
-
-        // Broadcast the size of the global_frontier
-        int global_frontier_size;
-        if (rank == 0) {
-            global_frontier_size = global_frontier.size();
-        }
-
-        // Broadcast the size of the global_frontier
-        MPI_Bcast(&global_frontier_size, 1, MPI_INT, 0, comm);
-
-        // Resize the global_frontier vector on non-root processes
-        if (rank != 0) {
-            global_frontier.resize(global_frontier_size);
+        long long global[2];
+        MPI_Allreduce(local, global, 2, MPI_LONG_LONG, MPI_MIN, comm);
+        end_dist = global[1];
+        if (global[0] == DIST_INFINITY || end_dist < global[0] * delta){
+            break;
         }
-
-        // Broadcast the global_frontier data
-        MPI_Bcast(global_frontier.data(), global_frontier_size, MPI_INT, 0, comm);
-    
-
-        struct Pair {
-            int first;
-            int second;
-
-            bool operator<(const Pair& other) const {
-                return (first < other.first) || (first == other.first && second < other.second);
-            }
-        };
-        // Create a custom MPI datatype for Pair
-        MPI_Datatype MPI_PAIR;
-        int blocklengths[] = {1, 1};
-        MPI_Aint displacements[] = {offsetof(Pair, first), offsetof(Pair, second)};
-        MPI_Datatype types[] = {MPI_INT, MPI_INT};
-        MPI_Type_create_struct(2, blocklengths, displacements, types, &MPI_PAIR);
-        MPI_Type_commit(&MPI_PAIR);
-
-        // local_neighbours - hashmap of child : parent, added by each process
-        // local_neighbours_paired - vector of pairs of child : parent, to be sent to process 0
-        // global_neighbours - final set of all neighbours to be broadcasted
-
-        std::vector<Pair> global_neighbours;
-
-        // Convert the std::pair<int, int> from the hashmap to Pair
-        std::vector<Pair> local_neighbours_paired(local_neighbours.size());
-        std::transform(local_neighbours.begin(), local_neighbours.end(), local_neighbours_paired.begin(),
-                    [](const std::pair<int, int>& p) { return Pair{p.first, p.second}; });
-
-        if (rank == 0) {
-            // temporary one to hold all the neighbours from all processes, to 
-            std::set<Pair> global_neighbours_temp;
-            // neighbours_seen - set of all neighbours added by all processes (to avoid duplicates)
-            std::set<int> neighbours_seen;
-
-            // just for proc 0
-            for (auto it = local_neighbours_paired.begin(); it != local_neighbours_paired.end(); it++) {
-                if (neighbours_seen.find(it->first) == neighbours_seen.end()) {
-                    // checking if the first element of the pair (the child) is already in the set
-                    // if not seen, insert into the set and the global_neighbours_temp
-                    global_neighbours_temp.insert(*it);
-                    neighbours_seen.insert(it->first);
-                    // We do this checking to prevent cycles in the maze, where different parents from different processes try to add the same child
+        current = global[0];
+
+        // Light edges until the bucket stays empty everywhere
+        int pending = 1;
+        while (pending){
+            std::vector<node_t> cells;
+            cells.swap(buckets[current % ring]);
+            queued -= cells.size();
+            for (node_t node : cells){
+                if (dist[node - first] / delta != current) continue; // Stale, filed again in a later bucket
+                if (!maze.is_visited_solve(node)){
+                    maze.set_visited_solve(node);
+                    settled.push_back(node);
                 }
+                relax(node, true);
             }
-
-            // Receive the local_neighbours_paired of other processes and insert them into the set
-            for (int i = 1; i < commSize; i++) {
-                int temp_size;
-                MPI_Recv(&temp_size, 1, MPI_INT, i, 0, comm, MPI_STATUS_IGNORE);
-                std::vector<Pair> temp(temp_size);
-                MPI_Recv(temp.data(), temp_size, MPI_PAIR, i, 0, comm, MPI_STATUS_IGNORE);
-
-                // similar to before, check if the first element of the pair is already in the set
-                for (auto it = temp.begin(); it != temp.end(); it++) {
-                    if (neighbours_seen.find(it->first) == neighbours_seen.end()) {
-                        global_neighbours_temp.insert(*it);
-                        neighbours_seen.insert(it->first);
-                    }
-                }
-            }
-
-            // Moving the values of the temp set to the main global_neighbours vector
-            global_neighbours.assign(global_neighbours_temp.begin(), global_neighbours_temp.end());
-
-        } else {
-            int global_neighbours_size = local_neighbours_paired.size();
-            MPI_Send(&global_neighbours_size, 1, MPI_INT, 0, 0, comm);
-            MPI_Send(local_neighbours_paired.data(), global_neighbours_size, MPI_PAIR, 0, 0, comm);
+            deliver();
+            int local_pending = !buckets[current % ring].empty();
+            MPI_Allreduce(&local_pending, &pending, 1, MPI_INT, MPI_MAX, comm);
         }
 
-        // Broadcast the size of the local_neighbours_paired
-        int global_neighbours_size;
-        if (rank == 0) {
-            global_neighbours_size = global_neighbours.size();
+        // Heavy edges of everything settled, their distances are final now
+        for (node_t node : settled){
+            relax(node, false);
         }
-
-        MPI_Bcast(&global_neighbours_size, 1, MPI_INT, 0, comm);
-
-        // Resize the local_neighbours_paired vector on non-root processes
-        if (rank != 0) {
-            global_neighbours.resize(global_neighbours_size);
-        }
-
-        // Broadcast the local_neighbours_paired data
-        MPI_Bcast(global_neighbours.data(), global_neighbours_size, MPI_PAIR, 0, comm);
-
-        // Free the custom MPI datatype
-        MPI_Type_free(&MPI_PAIR);
-
-    
-        // Add global_neighbours pairs to parent_map if it is not already present
-        for (auto it = global_neighbours.begin(); it != global_neighbours.end(); it++) {
-            if (parent_map.find(it->first) == parent_map.end()) {
-                parent_map[it->first] = it->second;
-            }
-        }
-
+        settled.clear();
+        deliver();
     }
-    
 
-    if (rank == found_rank){
-        // If found, update the PATH flags in maze
-        int end_node = end;
-        while (end_node != start){
-            SET_P(maze[end_node]);
-            end_node = parent_map[end_node];
+    // Walk the path back from end, handing over to the owner of the next cell whenever it leaves a rank's block
+    std::vector<node_t> path;
+    if (end_dist != DIST_INFINITY){
+        node_t node = end;
+        int holder = owner(end);
+        while (true){
+            if (rank == holder){
+                node = walk_parents(grid, maze, node, start, [&](node_t n) { return owner(n) == rank; }, [&](node_t n) { path.push_back(n); });
+            }
+            MPI_Bcast(&node, 1, MPI_NODE_T, holder, comm);
+            if (node == start) break;
+            holder = owner(node);
         }
-
-        // send found_rank to rank 0
-        // if 0 found it, no need to send
-        if (rank != 0)
-            MPI_Send(&found_rank, 1, MPI_INT, 0, 0, comm);
-    }
-
-    if (rank == 0 && found_rank != 0){
-        MPI_Status status;
-        MPI_Recv(&found_rank, 1, MPI_INT, MPI_ANY_SOURCE, 0, comm, &status);
     }
 
-    // Broadcast the found_rank from 0
-    MPI_Bcast(&found_rank, 1, MPI_INT, 0, comm);
-   
-    // broadcast the maze from the proc that found the end
-    MPI_Bcast(maze, size * size, MPI_SHORT, found_rank, comm);
-    // printf("Rank %d finished\n", rank);
+    share_path(maze, path, comm);
+}
 
-}
\ No newline at end of file
+#define INSTANTIATE_DIJKSTRA(GridT, Cells) template void solveUsingDijkstra<GridT, Cells>(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end, int delta);
+FOR_EACH_MAZE_TYPE(INSTANTIATE_DIJKSTRA)
@@ -1,3 +1,18 @@
 #include <mpi.h>
 #include "defs.hpp"
-void solveUsingDijkstra(int size, short* maze, MPI_Comm comm, int start, int end);
\ No newline at end of file
+#include "cells.hpp"
+#include "grid.hpp"
+
+// Cost of entering a C cell: 1 + its weight (the node weights expand_edges_to_maze keeps, 0 without weights)
+#define MAX_CELL_COST 256
+template <class Cells>
+inline node_t cell_cost(const Cells& maze, node_t node) { return 1 + (maze.has_weights() ? maze.weight(node) : 0); }
+
+// Default bucket width of the delta-stepping solver (--delta), in units of cell cost (1 + weight, so 1 to 256)
+// At the largest cell cost every edge is light, which needs the fewest rounds of messages (bench/delta.sh)
+#define DIJKSTRA_DEFAULT_DELTA 256
+
+// Minimum cost path from start to end through the C cells, entering a cell costs 1 + its weight (0 without weights)
+// Distributed delta-stepping with buckets of width delta (see dijkstra.cpp), the path is marked P on every rank
+template <class GridT, class Cells>
+void solveUsingDijkstra(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end, int delta = DIJKSTRA_DEFAULT_DELTA);
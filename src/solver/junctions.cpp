@@ -0,0 +1,214 @@
+#include <mpi.h>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+
+#include "junctions.hpp"
+#include "dijkstra.hpp"
+
+// Corridor contraction: the mazes of expand_edges_to_maze are mostly corridors of cells with two C neighbours, which
+// the cell solvers go through one step at a time. Here every corridor becomes one weighted edge between the junctions
+// at its ends, the search only sees the junctions and the path is expanded back to cells once it is known
+// - Built in three passes, parallel over the threads: the junction bits (64 cells per word, one writer per word), the
+//   junction cells and degrees (every word knows its first junction from the ranks), then the corridors walked from
+//   every junction (each thread writes the edges of its own junctions)
+// - Every corridor is walked from both ends, once per direction, which keeps the passes free of synchronisation
+// - A corridor that comes back to its junction is a loop edge, a cycle of degree-2 cells with no junction on it is
+//   never reached from one and is simply left out
+
+template <class GridT>
+template <class Cells>
+JunctionGraph<GridT>::JunctionGraph(const GridT& grid, const Cells& maze, const std::vector<node_t>& terminals) : grid(grid) {
+    node_t n = maze.count();
+    bits.assign((n + 63) / 64, 0);
+    ranks.assign(bits.size() + 1, 0);
+    auto open_degree = [&](node_t node) {
+        int degree = 0;
+        grid.for_each_neighbour(node, [&](node_t next, int) {
+            degree += maze.is_c(next);
+            return false;
+        });
+        return degree;
+    };
+
+    #pragma omp parallel for schedule(static)
+    for (node_t w = 0; w < (node_t)bits.size(); w++) {
+        uint64_t word = 0;
+        for (node_t node = w * 64; node < std::min(n, w * 64 + 64); node++) {
+            if (maze.is_c(node) && open_degree(node) != 2) {
+                word |= 1ull << (node & 63);
+            }
+        }
+        bits[w] = word;
+    }
+    for (node_t node : terminals) {
+        if (maze.is_c(node)) bits[node >> 6] |= 1ull << (node & 63);
+    }
+
+    for (node_t w = 0; w < (node_t)bits.size(); w++) {
+        ranks[w + 1] = ranks[w] + __builtin_popcountll(bits[w]);
+    }
+    node_t count = ranks.back();
+    cells.resize(count);
+    offsets.assign(count + 1, 0);
+    #pragma omp parallel for schedule(static)
+    for (node_t w = 0; w < (node_t)bits.size(); w++) {
+        node_t j = ranks[w];
+        for (uint64_t word = bits[w]; word; word &= word - 1, j++) {
+            cells[j] = w * 64 + __builtin_ctzll(word);
+            offsets[j + 1] = open_degree(cells[j]);
+        }
+    }
+    for (node_t j = 0; j < count; j++) {
+        offsets[j + 1] += offsets[j];
+    }
+    edges.resize(offsets[count]);
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (node_t j = 0; j < count; j++) {
+        Edge* out = edges.data() + offsets[j];
+        grid.for_each_neighbour(cells[j], [&](node_t next, int) {
+            if (!maze.is_c(next)) return false;
+            node_t prev = cells[j], cost = cell_cost(maze, next);
+            uint32_t length = 1;
+            while (!((bits[next >> 6] >> (next & 63)) & 1)) {
+                // A corridor cell has exactly one C neighbour besides the one we came from
+                node_t here = next;
+                grid.for_each_neighbour(here, [&](node_t other, int) {
+                    if (other == prev || !maze.is_c(other)) return false;
+                    next = other;
+                    return true;
+                });
+                prev = here;
+                cost += cell_cost(maze, next);
+                length++;
+            }
+            *out++ = Edge{cost, (uint32_t)index(next), length};
+            return false;
+        });
+    }
+}
+
+template <class GridT>
+uint32_t JunctionGraph<GridT>::source(node_t edge) const {
+    return std::upper_bound(offsets.begin(), offsets.end(), edge) - offsets.begin() - 1;
+}
+
+template <class GridT>
+template <class Cells, class F>
+void JunctionGraph<GridT>::walk(const Cells& maze, node_t edge, F f) const {
+    node_t from = cells[source(edge)], prev = from, next = -1;
+    // The edge leaves through the (edge - offsets)-th C neighbour of its source
+    node_t skip = edge - offsets[source(edge)];
+    grid.for_each_neighbour(from, [&](node_t other, int) {
+        if (!maze.is_c(other) || skip-- > 0) return false;
+        next = other;
+        return true;
+    });
+    for (uint32_t step = 0; step < edges[edge].length; step++) {
+        f(next);
+        if (step + 1 == edges[edge].length) break;
+        node_t here = next;
+        grid.for_each_neighbour(here, [&](node_t other, int) {
+            if (other == prev || !maze.is_c(other)) return false;
+            next = other;
+            return true;
+        });
+        prev = here;
+    }
+}
+
+// A* with h = Manhattan distance of the junction to the target: an edge of length L costs at least L (in steps or in
+// cell costs) and moves by at most L cells, so h stays consistent and a junction is final when it is closed
+// - Edge costs are unbounded (a corridor is as long as it likes), which rules out the bucket ring of astar.cpp: the
+//   open list is a radix heap (radixheap.hpp), which only needs f to never decrease
+// - Entries are (f, g, junction) and are never updated, a junction is only pushed again when its g gets lower. The edge
+//   that gave the best g is kept per junction, it is the path back once the target is closed
+template <class GridT>
+JunctionSearch<GridT>::JunctionSearch(const GridT& grid, const JunctionGraph<GridT>& graph)
+    : grid(grid), graph(graph), state(graph.junctions(), State{INT64_MAX, -1}) {}
+
+template <class GridT>
+template <class Cost, class F>
+node_t JunctionSearch<GridT>::search(uint32_t source, uint32_t target, Cost cost, F on_close) {
+    for (uint32_t j : touched) {
+        state[j] = State{INT64_MAX, -1};
+    }
+    touched.clear();
+    open.clear();
+
+    node_t goal = graph.cell(target);
+    auto h = [&](node_t node) {
+        return (node_t)(llabs(grid.row(node) - grid.row(goal)) + llabs(grid.col(node) - grid.col(goal)));
+    };
+    state[source].best = 0;
+    touched.push_back(source);
+    open.push(Entry{h(graph.cell(source)), 0, source});
+    while (!open.empty()) {
+        Entry entry = open.pop();
+        uint32_t j = entry.junction;
+        if (state[j].best < 0) continue;
+        state[j].best = -1;
+        on_close(j);
+        if (j == target) {
+            return entry.g;
+        }
+        for (const auto* e = graph.edges_begin(j); e != graph.edges_end(j); e++) {
+            node_t g = entry.g + cost(*e);
+            State& s = state[e->target];
+            if (g < s.best) {
+                if (s.best == INT64_MAX) touched.push_back(e->target);
+                s.best = g;
+                s.via = graph.edge_id(e);
+                open.push(Entry{g + h(graph.cell(e->target)), g, e->target});
+            }
+        }
+    }
+    return -1;
+}
+
+template <class GridT>
+node_t JunctionSearch<GridT>::distance(node_t a, node_t b) {
+    int64_t source = graph.index(a), target = graph.index(b);
+    if (source == -1 || target == -1) {
+        return -1;
+    }
+    typedef typename JunctionGraph<GridT>::Edge Edge;
+    return search(source, target, [](const Edge& e) { return (node_t)e.length; }, [](uint32_t) {});
+}
+
+template <class GridT>
+template <class Cells>
+bool JunctionSearch<GridT>::solve(Cells& maze, node_t a, node_t b) {
+    int64_t source = graph.index(a), target = graph.index(b);
+    if (source == -1 || target == -1) {
+        return false;
+    }
+    typedef typename JunctionGraph<GridT>::Edge Edge;
+    node_t cost = search(source, target, [](const Edge& e) { return e.cost; }, [&](uint32_t j) { maze.set_visited_solve(graph.cell(j)); });
+    if (cost == -1) {
+        return false;
+    }
+    // Expand the corridors of the path back to cells, from b to a
+    for (uint32_t j = target; j != source; j = graph.source(state[j].via)) {
+        graph.walk(maze, state[j].via, [&](node_t node) { maze.set_p(node); });
+    }
+    return true;
+}
+
+template <class GridT, class Cells>
+void solveUsingJunctionGraph(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end) {
+    JunctionGraph<GridT> graph(grid, maze, std::vector<node_t>{start, end});
+    JunctionSearch<GridT> search(grid, graph);
+    search.solve(maze, start, end);
+}
+
+#define INSTANTIATE_JUNCTIONS(GridT) \
+    template class JunctionGraph<GridT>; \
+    template class JunctionSearch<GridT>;
+FOR_EACH_GRID_TYPE(INSTANTIATE_JUNCTIONS)
+#define INSTANTIATE_JUNCTION_SOLVER(GridT, Cells) \
+    template JunctionGraph<GridT>::JunctionGraph(const GridT& grid, const Cells& maze, const std::vector<node_t>& terminals); \
+    template bool JunctionSearch<GridT>::solve<Cells>(Cells& maze, node_t a, node_t b); \
+    template void solveUsingJunctionGraph<GridT, Cells>(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end);
+FOR_EACH_MAZE_TYPE(INSTANTIATE_JUNCTION_SOLVER)
@@ -0,0 +1,107 @@
+#ifndef JUNCTIONS_H
+#define JUNCTIONS_H
+
+#include <mpi.h>
+#include <vector>
+#include <stdint.h>
+
+#include "defs.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
+#include "radixheap.hpp"
+
+// The maze with its corridors contracted (see junctions.cpp): the vertices are the junctions, i.e. the C cells that
+// don't have exactly two C neighbours (crossings, forks, dead ends) plus the terminals the searches start and end at,
+// and an edge is a corridor of degree-2 cells from one junction to the next
+// - An edge has the cost of entering all its cells, the far junction included (cell_cost of dijkstra.hpp), and its
+//   length in steps. Both directions of a corridor are stored since their costs differ by the two end cells
+// - Junctions are numbered in cell order, their edges are consecutive (CSR) and the i-th edge of a junction leaves it
+//   through its i-th C neighbour (for_each_neighbour order), so the corridor can be walked again from it
+// - 16 bytes per edge and per junction, plus the junction bits and their ranks (1.5 bits per cell). A search adds
+//   16 bytes per junction (JunctionSearch)
+template <class GridT>
+class JunctionGraph {
+public:
+    struct Edge {
+        node_t cost;
+        uint32_t target; // Junction index
+        uint32_t length;
+    };
+
+    template <class Cells>
+    JunctionGraph(const GridT& grid, const Cells& maze, const std::vector<node_t>& terminals);
+    JunctionGraph(const JunctionGraph&) = delete;
+
+    node_t junctions() const { return cells.size(); }
+    node_t edge_count() const { return edges.size(); }
+    node_t cell(uint32_t junction) const { return cells[junction]; }
+    // Junction index of a cell, -1 if it is not a junction
+    int64_t index(node_t cell) const {
+        uint64_t word = bits[cell >> 6], below = (1ull << (cell & 63)) - 1;
+        return (word >> (cell & 63)) & 1 ? (int64_t)ranks[cell >> 6] + __builtin_popcountll(word & below) : -1;
+    }
+    // Junction an edge starts from
+    uint32_t source(node_t edge) const;
+
+    const Edge* edges_begin(uint32_t junction) const { return edges.data() + offsets[junction]; }
+    const Edge* edges_end(uint32_t junction) const { return edges.data() + offsets[junction + 1]; }
+    node_t edge_id(const Edge* edge) const { return edge - edges.data(); }
+
+    // Call f(cell) for the cells of an edge, from the one after its source to its target included
+    template <class Cells, class F>
+    void walk(const Cells& maze, node_t edge, F f) const;
+
+    size_t bytes() const {
+        return bits.size() * sizeof(uint64_t) + ranks.size() * sizeof(uint32_t) + cells.size() * sizeof(node_t) +
+               offsets.size() * sizeof(node_t) + edges.size() * sizeof(Edge);
+    }
+
+private:
+    const GridT& grid;
+    std::vector<uint64_t> bits; // Junction bit of every cell
+    std::vector<uint32_t> ranks; // Junctions before every word of bits, index() is a rank in O(1)
+    std::vector<node_t> cells; // Cell of every junction, increasing
+    std::vector<node_t> offsets; // Edges of junction j are [offsets[j], offsets[j + 1])
+    std::vector<Edge> edges;
+};
+
+// A* on a JunctionGraph with the Manhattan distance as heuristic (see junctions.cpp). One per thread: the graph is
+// shared read-only, the scratch is kept from one search to the next and only what the last search touched is reset
+template <class GridT>
+class JunctionSearch {
+public:
+    JunctionSearch(const GridT& grid, const JunctionGraph<GridT>& graph);
+
+    // Distance in steps between two terminals, -1 if they are not connected (--queries)
+    node_t distance(node_t a, node_t b);
+    // Minimum cost path (costs of dijkstra.hpp) from terminal a to terminal b, marked P without a. The cells of the
+    // junctions it closed get the VISITED_SOLVE bit
+    template <class Cells>
+    bool solve(Cells& maze, node_t a, node_t b);
+
+private:
+    struct Entry {
+        node_t f, g;
+        uint32_t junction;
+    };
+    template <class Cost, class F>
+    node_t search(uint32_t source, uint32_t target, Cost cost, F on_close);
+
+    const GridT& grid;
+    const JunctionGraph<GridT>& graph;
+    RadixHeap<Entry> open;
+    // Lowest g of a junction (-1 once it is closed) and the edge it came from, side by side for one cache miss
+    struct State {
+        node_t best, via;
+    };
+    std::vector<State> state;
+    std::vector<uint32_t> touched; // Junctions whose state the last search set
+};
+
+// Minimum cost path from start to end (costs of dijkstra.hpp) with A* on the junction graph, the corridors of the path
+// are expanded back to cells at the end and marked P. A rank's VISITED_SOLVE bits are the junctions it closed
+// Every rank builds its own graph with its threads (-t), there is no communication
+template <class GridT, class Cells>
+void solveUsingJunctionGraph(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end);
+
+#endif // JUNCTIONS_H
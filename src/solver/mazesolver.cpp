@@ -8,16 +8,30 @@
 #include "mazesolver.hpp"
 // Entry to the maze should be at top right (0,63) and exit from the maze should be at bottom left (63,0)
 
-void solver_main(int size, short* maze, char solving_algorithm[MAX_ARG_LEN], MPI_Comm comm, int start, int end){
+template <class GridT, class Cells>
+void solver_main(const GridT& grid, Cells& maze, char solving_algorithm[MAX_ARG_LEN], MPI_Comm comm, node_t start, node_t end, int delta){
     int rank;
     MPI_Comm_rank(comm, &rank);
     if (strcmp(solving_algorithm, "dfs") == 0){
-        solveUsingDFS(size, maze, comm, start, end);
+        solveUsingDFS(grid, maze, comm, start, end);
+    } else if (strcmp(solving_algorithm, "wsdfs") == 0){
+        solveUsingWorkStealingDFS(grid, maze, comm, start, end);
     } else if (strcmp(solving_algorithm, "dijkstra") == 0){
-        solveUsingDijkstra(size, maze, comm, start, end);
+        solveUsingDijkstra(grid, maze, comm, start, end, delta);
+    } else if (strcmp(solving_algorithm, "astar") == 0){
+        solveUsingAStar(grid, maze, comm, start, end, delta);
+    } else if (strcmp(solving_algorithm, "bibfs") == 0){
+        solveUsingBidirectionalBFS(grid, maze, comm, start, end);
+    } else if (strcmp(solving_algorithm, "lca") == 0){
+        solveUsingTreeIndex(grid, maze, comm, start, end);
+    } else if (strcmp(solving_algorithm, "junction") == 0){
+        solveUsingJunctionGraph(grid, maze, comm, start, end);
     }
     else {
         printf("Invalid solving algorithm\n");
     }
 
-}
\ No newline at end of file
+}
+
+#define INSTANTIATE_SOLVER(GridT, Cells) template void solver_main<GridT, Cells>(const GridT& grid, Cells& maze, char solving_algorithm[MAX_ARG_LEN], MPI_Comm comm, node_t start, node_t end, int delta);
+FOR_EACH_MAZE_TYPE(INSTANTIATE_SOLVER)
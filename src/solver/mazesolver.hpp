@@ -1,5 +1,14 @@
 #include "defs.hpp"
+#include "grid.hpp"
 #include "dfs.hpp"
+#include "wsdfs.hpp"
 #include "dijkstra.hpp"
+#include "astar.hpp"
+#include "bibfs.hpp"
+#include "pathindex.hpp"
+#include "junctions.hpp"
 
-void solver_main(int size, short* maze, char solving_algorithm[MAX_ARG_LEN], MPI_Comm comm, int start, int end);
\ No newline at end of file
+// delta is the bucket width of the delta-stepping solver (dijkstra) and the f window of the distributed astar, the other
+// solvers ignore it
+template <class GridT, class Cells>
+void solver_main(const GridT& grid, Cells& maze, char solving_algorithm[MAX_ARG_LEN], MPI_Comm comm, node_t start, node_t end, int delta = DIJKSTRA_DEFAULT_DELTA);
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+
+#include "pathindex.hpp"
+
+// Lowest common ancestors with jump pointers (Myers, "An applicative random-access stack"), the linear space form of
+// binary lifting: instead of the 2^k-th ancestors of every cell, a cell keeps a single jump pointer
+// - jump(v) = jump(jump(p)) if the jumps of the parent p and of jump(p) span the same number of levels, p otherwise.
+//   The jump lengths then follow the skew-binary numbers, and any ancestor is reached in O(log depth) jumps / steps
+// - The jump length only depends on the depth, so two cells at the same depth jump to the same depth: the LCA lifts
+//   the deeper cell to the depth of the other one, then moves both up by jumps while their jumps differ, by single
+//   steps otherwise
+// - The root is the start of the maze, its parent and jump are itself
+
+template <class GridT>
+template <class Cells>
+TreePathIndex<GridT>::TreePathIndex(const GridT& grid, const Cells& maze, node_t root)
+    : grid(grid), parents(maze.count(), PLANE_PARENT), entries(maze.count(), Entry{UNREACHED, 0}),
+      root(root), reached(0), extra_edges(0) {
+    if (!maze.is_c(root)) {
+        return;
+    }
+    // Preorder traversal, a cell gets its depth and jump as soon as it is discovered (its parent already has them)
+    std::vector<node_t> stack(1, root);
+    entries[root] = Entry{0, (uint32_t)root};
+    reached = 1;
+    node_t seen_edges = 0; // Every edge between reached cells is seen from both ends
+    while (!stack.empty()) {
+        node_t node = stack.back();
+        stack.pop_back();
+        Entry here = entries[node], up = entries[here.jump];
+        uint32_t target = up.depth - entries[up.jump].depth == here.depth - up.depth ? up.jump : (uint32_t)node;
+        grid.for_each_neighbour(node, [&](node_t child, int dir) {
+            if (!maze.is_c(child)) return false;
+            seen_edges++;
+            if (entries[child].depth != UNREACHED) return false;
+            entries[child] = Entry{here.depth + 1, target};
+            parents.set_parent_dir(child, OPPOSITE_DIR(dir));
+            stack.push_back(child);
+            reached++;
+            return false;
+        });
+    }
+    // A tree on reached cells has reached - 1 edges
+    extra_edges = seen_edges / 2 - (reached - 1);
+}
+
+// Ancestor of node at depth d (d at most the depth of node)
+template <class GridT>
+node_t TreePathIndex<GridT>::ancestor_at(node_t node, uint32_t d) const {
+    while (entries[node].depth > d) {
+        uint32_t up = entries[node].jump;
+        node = entries[up].depth >= d ? (node_t)up : parent(node);
+    }
+    return node;
+}
+
+template <class GridT>
+node_t TreePathIndex<GridT>::lca(node_t a, node_t b) const {
+    if (!is_reachable(a) || !is_reachable(b)) {
+        return -1;
+    }
+    if (entries[a].depth > entries[b].depth) {
+        a = ancestor_at(a, entries[b].depth);
+    } else {
+        b = ancestor_at(b, entries[a].depth);
+    }
+    while (a != b) {
+        if (entries[a].jump != entries[b].jump) {
+            a = entries[a].jump;
+            b = entries[b].jump;
+        } else {
+            a = parent(a);
+            b = parent(b);
+        }
+    }
+    return a;
+}
+
+template <class GridT>
+node_t TreePathIndex<GridT>::distance(node_t a, node_t b) const {
+    node_t common = lca(a, b);
+    if (common == -1) {
+        return -1;
+    }
+    return (node_t)entries[a].depth + entries[b].depth - 2 * (node_t)entries[common].depth;
+}
+
+template <class GridT>
+void TreePathIndex<GridT>::path(node_t a, node_t b, std::vector<node_t>& out) const {
+    out.clear();
+    node_t common = lca(a, b);
+    if (common == -1) {
+        return;
+    }
+    // a up to the LCA, then b up to (not including) the LCA in reverse
+    walk_parents(grid, parents, a, common, [&](node_t node) { out.push_back(node); });
+    out.push_back(common);
+    size_t middle = out.size();
+    walk_parents(grid, parents, b, common, [&](node_t node) { out.push_back(node); });
+    std::reverse(out.begin() + middle, out.end());
+}
+
+template <class GridT, class Cells>
+void solveUsingTreeIndex(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    TreePathIndex<GridT> index(grid, maze, start);
+    if (index.loops() > 0) {
+        if (rank == 0)
+            fprintf(stderr, "Error: -s lca needs a perfect maze, this one has %lld loops\n", (long long)index.loops());
+        MPI_Abort(comm, 1);
+    }
+    std::vector<node_t> path;
+    index.path(end, start, path);
+    for (node_t node : path) {
+        if (node != start) maze.set_p(node);
+    }
+}
+
+#define INSTANTIATE_PATH_INDEX(GridT) template class TreePathIndex<GridT>;
+FOR_EACH_GRID_TYPE(INSTANTIATE_PATH_INDEX)
+#define INSTANTIATE_TREE_INDEX(GridT, Cells) \
+    template TreePathIndex<GridT>::TreePathIndex(const GridT& grid, const Cells& maze, node_t root); \
+    template void solveUsingTreeIndex<GridT, Cells>(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end);
+FOR_EACH_MAZE_TYPE(INSTANTIATE_TREE_INDEX)
@@ -0,0 +1,60 @@
+#ifndef PATHINDEX_H
+#define PATHINDEX_H
+
+#include <mpi.h>
+#include <vector>
+#include <stdint.h>
+
+#include "defs.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
+
+// Path index of a perfect maze: the C cells form a tree, so the path between any two cells is unique and goes through
+// their lowest common ancestor once the tree is rooted (see pathindex.cpp)
+// - Built once in O(cells) with a traversal from the root, then a distance query costs O(log cells) and a path query
+//   O(log cells + path length), without touching the maze again
+// - Per cell: the depth and one jump pointer next to each other (32 bits each, ids fit as there are at most
+//   65536 x 65536 cells, one cache line per hop of a query) and the parent direction (2 bits), ~8.25 bytes per cell
+// - Cells that are walls or not connected to the root are unreachable: queries about them return -1 / an empty path
+template <class GridT>
+class TreePathIndex {
+public:
+    template <class Cells>
+    TreePathIndex(const GridT& grid, const Cells& maze, node_t root);
+    TreePathIndex(const TreePathIndex&) = delete;
+
+    // Edges between reachable cells that are not tree edges (0 for a perfect maze, the paths are not shortest otherwise)
+    node_t loops() const { return extra_edges; }
+    node_t reachable() const { return reached; }
+    bool is_reachable(node_t node) const { return entries[node].depth != UNREACHED; }
+
+    node_t lca(node_t a, node_t b) const;
+    // Number of steps between a and b, -1 if they are not connected
+    node_t distance(node_t a, node_t b) const;
+    // The cells from a to b (both included) in order, empty if they are not connected
+    void path(node_t a, node_t b, std::vector<node_t>& out) const;
+
+    size_t bytes() const { return entries.size() * sizeof(Entry) + ((size_t)parents.count() + 3) / 4; }
+
+private:
+    static const uint32_t UNREACHED = UINT32_MAX;
+    struct Entry {
+        uint32_t depth;
+        uint32_t jump;
+    };
+
+    node_t parent(node_t node) const { return grid.step(node, parents.parent_dir(node)); }
+    node_t ancestor_at(node_t node, uint32_t d) const;
+
+    const GridT& grid;
+    BitplaneCells parents;
+    std::vector<Entry> entries;
+    node_t root, reached, extra_edges;
+};
+
+// Path from start to end through the tree index rooted at start (a perfect maze is required), marked P on every rank
+// Every rank builds its own index, there is no communication
+template <class GridT, class Cells>
+void solveUsingTreeIndex(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end);
+
+#endif // PATHINDEX_H
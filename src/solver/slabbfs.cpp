@@ -0,0 +1,120 @@
+#include <mpi.h>
+#include <vector>
+#include "slabbfs.hpp"
+
+// - Level synchronous BFS over a maze split in row slabs (see slab.hpp), every rank expands the frontier in its slab
+// - Cells discovered in a ghost row belong to a neighbour: they are sent over (as columns) and join the neighbour's
+//   next frontier with the parent on our side
+// - The parent direction is kept in the cells like in the other solvers, the path is walked back from the end by the
+//   rank owning the current cell and handed over every time it crosses into another slab
+
+// Send the columns found in our ghost rows to the neighbours and receive theirs
+static void exchange_boundary(const Slab& slab, std::vector<int32_t>& send_up, std::vector<int32_t>& send_down,
+                              std::vector<int32_t>& from_up, std::vector<int32_t>& from_down, MPI_Comm comm) {
+    int counts_out[2] = {(int)send_up.size(), (int)send_down.size()};
+    int from_down_count = 0, from_up_count = 0;
+    MPI_Sendrecv(&counts_out[0], 1, MPI_INT, slab.up, 0, &from_down_count, 1, MPI_INT, slab.down, 0, comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(&counts_out[1], 1, MPI_INT, slab.down, 1, &from_up_count, 1, MPI_INT, slab.up, 1, comm, MPI_STATUS_IGNORE);
+    from_down.resize(from_down_count);
+    from_up.resize(from_up_count);
+    MPI_Sendrecv(send_up.data(), counts_out[0], MPI_INT32_T, slab.up, 2, from_down.data(), from_down_count, MPI_INT32_T, slab.down, 2, comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(send_down.data(), counts_out[1], MPI_INT32_T, slab.down, 3, from_up.data(), from_up_count, MPI_INT32_T, slab.up, 3, comm, MPI_STATUS_IGNORE);
+}
+
+// Function to solve a maze split in slabs using BFS and MPI
+// @param slab: The rows of the maze owned by this rank
+// @param maze: The cells of the slab, ghost rows included (C bits of the ghost rows filled in by exchange_halos)
+template <class Cells>
+void solveSlabUsingBFS(const Slab& slab, Cells& maze, MPI_Comm comm) {
+    DynamicGrid grid = slab.grid();
+    node_t start = slab.owns(0) ? slab.node(0, slab.width - 1) : -1;
+    node_t end = slab.owns(slab.height - 1) ? slab.node(slab.height - 1, 0) : -1;
+
+    std::vector<node_t> frontier, next_frontier;
+    std::vector<int32_t> send_up, send_down, from_up, from_down;
+    if (start != -1) {
+        maze.set_visited_solve(start);
+        frontier.push_back(start);
+    }
+
+    bool found = false;
+    while (true) {
+        next_frontier.clear();
+        send_up.clear();
+        send_down.clear();
+        for (node_t node : frontier) {
+            grid.for_each_neighbour(node, [&](node_t child, int dir) {
+                if (maze.is_c(child) && !maze.is_visited_solve(child)) {
+                    maze.set_visited_solve(child);
+                    maze.set_parent_dir(child, OPPOSITE_DIR(dir));
+                    node_t row = grid.row(child);
+                    if (row == 0) send_up.push_back(grid.col(child));
+                    else if (row == slab.rows + 1) send_down.push_back(grid.col(child));
+                    else next_frontier.push_back(child);
+                }
+                return false;
+            });
+        }
+
+        // Cells the neighbours found in our boundary rows, their parent is in the ghost row next to them
+        exchange_boundary(slab, send_up, send_down, from_up, from_down, comm);
+        for (int32_t col : from_up) {
+            node_t child = slab.node(slab.first_row, col);
+            if (!maze.is_visited_solve(child)) {
+                maze.set_visited_solve(child);
+                maze.set_parent_dir(child, UP);
+                next_frontier.push_back(child);
+            }
+        }
+        for (int32_t col : from_down) {
+            node_t child = slab.node(slab.first_row + slab.rows - 1, col);
+            if (!maze.is_visited_solve(child)) {
+                maze.set_visited_solve(child);
+                maze.set_parent_dir(child, DOWN);
+                next_frontier.push_back(child);
+            }
+        }
+
+        // Stop once the end is reached, or nothing is left to expand anywhere
+        long long local[2] = {end != -1 && maze.is_visited_solve(end), (long long)next_frontier.size()};
+        long long global[2];
+        MPI_Allreduce(local, global, 2, MPI_LONG_LONG, MPI_SUM, comm);
+        if (global[0] > 0) {
+            found = true;
+            break;
+        }
+        if (global[1] == 0) {
+            break;
+        }
+        frontier.swap(next_frontier);
+    }
+
+    if (!found) {
+        return;
+    }
+
+    // Walk back from the end, the rank holding the current cell marks the path until it reaches the start or a ghost
+    // row, then broadcasts the maze cell it stopped at (row * width + col) and the owner of that row carries on
+    int holder = slab.owner(slab.height - 1);
+    long long current = (long long)(slab.height - 1) * slab.width;
+    while (true) {
+        long long handoff = -1;
+        if (slab.rank == holder) {
+            node_t node = slab.node(current / slab.width, current % slab.width);
+            auto in_slab = [&](node_t n) { return grid.row(n) != 0 && grid.row(n) != slab.rows + 1; };
+            node = walk_parents(grid, maze, node, start, in_slab, [&](node_t n) { maze.set_p(n); });
+            if (node != start) {
+                handoff = (long long)slab.global_row(grid.row(node)) * slab.width + grid.col(node);
+            }
+        }
+        MPI_Bcast(&handoff, 1, MPI_LONG_LONG, holder, comm);
+        if (handoff == -1) {
+            break;
+        }
+        current = handoff;
+        holder = slab.owner(current / slab.width);
+    }
+}
+
+template void solveSlabUsingBFS<PackedCells>(const Slab& slab, PackedCells& maze, MPI_Comm comm);
+template void solveSlabUsingBFS<BitplaneCells>(const Slab& slab, BitplaneCells& maze, MPI_Comm comm);
@@ -0,0 +1,6 @@
+#include <mpi.h>
+#include "defs.hpp"
+#include "cells.hpp"
+#include "slab.hpp"
+template <class Cells>
+void solveSlabUsingBFS(const Slab& slab, Cells& maze, MPI_Comm comm);
@@ -0,0 +1,335 @@
+#include <mpi.h>
+#include <omp.h>
+#include <sched.h>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "wsdfs.hpp"
+#include "workdeque.hpp"
+#include "mpiutils.hpp"
+
+// DFS with work stealing: instead of fixing each rank's share of the maze up front (solveUsingDFS), whoever runs out of
+// cells takes the oldest entries of someone else's DFS stack, i.e. the cells closest to the root and so the largest
+// unexplored subtrees
+// - Every thread of a rank (-t) has a lock-free deque (workdeque.hpp): it pushes the unvisited neighbours of the cell it
+//   takes and takes the newest entry (DFS order), an idle thread steals the oldest entry of another thread's deque.
+//   The threads share the rank's cells, a cell belongs to the thread that claims it (claim_solve, atomic)
+// - Between ranks the master thread of every rank offers the oldest entries of its threads' deques in an MPI window
+//   (OfferWindow), and an idle master steals half of another rank's offer with one-sided gets / compare-and-swaps, so
+//   the victim never stops to answer. An offer nobody took is taken back when the rank runs dry
+// - Ranks have their own copy of the maze, so an entry carries the direction of its parent: the thief claims the cell
+//   with it and marks the parent visited so that it doesn't walk into the victim's part of the maze
+// - Only rank 0 starts, with the start cell; the other ranks get their first cells by stealing
+// - Termination: the masters run nonblocking MIN-reductions of (lowest rank that found the end, whether the rank is
+//   idle and did not steal since its previous contribution), one at a time as in solveUsingDFS. A rank only gets work
+//   by stealing, so two reductions in a row where every rank is idle and did not steal mean no work was left anywhere
+//   in between (the maze has no path)
+// - Path: the finder walks the parents up to the start or to a cell it stole from another rank, the victim carries on
+//   from that cell, and so on; the pieces are marked P everywhere
+
+// A stack entry: the cell and the direction of its parent
+#define ENTRY(node, dir) ((int64_t)(node) << 4 | (dir))
+#define ENTRY_NODE(entry) ((node_t)((entry) >> 4))
+#define ENTRY_DIR(entry) ((int)((entry) & 0x0F))
+
+// The entries a rank offers to the others, in an MPI window only read with gets and atomics (passive target)
+// | 0     | state: generation (16 bits), first (24 bits), end (24 bits), the entries on offer are [first, end)
+// | 1 + i | entry i
+// A thief reads the state and the first half of the entries, then moves first with a compare-and-swap that fails if the
+// state changed meanwhile. The owner only writes entries when nothing is on offer and then bumps the generation, so
+// a thief can't end up with entries that were overwritten under it
+class OfferWindow {
+public:
+    explicit OfferWindow(MPI_Comm comm) : generation(0) {
+        MPI_Comm_rank(comm, &rank);
+        MPI_Win_allocate((1 + WSDFS_SHARE) * sizeof(uint64_t), sizeof(uint64_t), MPI_INFO_NULL, comm, &base, &win);
+        base[0] = pack(0, 0, 0);
+        MPI_Win_lock_all(0, win);
+        MPI_Win_sync(win);
+        MPI_Barrier(comm);
+    }
+
+    // Collective, once no rank steals anymore
+    void free() {
+        MPI_Win_unlock_all(win);
+        MPI_Win_free(&win);
+    }
+
+    bool empty() {
+        uint64_t state = read_state(rank);
+        return first_of(state) == end_of(state);
+    }
+
+    // Put at most WSDFS_SHARE entries on offer, only when nothing is
+    void offer(const std::vector<int64_t>& entries) {
+        int count = entries.size();
+        MPI_Put(entries.data(), count, MPI_INT64_T, rank, 1, count, MPI_INT64_T, win);
+        MPI_Win_flush(rank, win);
+        uint64_t state = pack(++generation, 0, count), old;
+        MPI_Fetch_and_op(&state, &old, MPI_UINT64_T, rank, 0, MPI_REPLACE, win);
+        MPI_Win_flush(rank, win);
+        offered = entries;
+    }
+
+    // Take back what the other ranks left of the offer, appended to out
+    void reclaim(std::vector<int64_t>& out) {
+        while (true) {
+            uint64_t state = read_state(rank);
+            uint64_t first = first_of(state), end = end_of(state);
+            if (first == end) return;
+            if (swap_state(rank, state, pack(generation, end, end))) {
+                out.insert(out.end(), offered.begin() + first, offered.begin() + end);
+                return;
+            }
+        }
+    }
+
+    // Take the first half of victim's offer, appended to out; false if there was none or another rank got it first
+    bool steal(int victim, std::vector<int64_t>& out) {
+        uint64_t state = read_state(victim);
+        uint64_t first = first_of(state), end = end_of(state);
+        if (first == end) return false;
+        int count = (end - first + 1) / 2;
+        int64_t entries[WSDFS_SHARE];
+        MPI_Get(entries, count, MPI_INT64_T, victim, 1 + first, count, MPI_INT64_T, win);
+        MPI_Win_flush(victim, win);
+        if (!swap_state(victim, state, pack(state >> 48, first + count, end))) return false;
+        out.insert(out.end(), entries, entries + count);
+        return true;
+    }
+
+private:
+    static uint64_t pack(uint64_t generation, uint64_t first, uint64_t end) { return (generation & 0xFFFF) << 48 | first << 24 | end; }
+    static uint64_t first_of(uint64_t state) { return (state >> 24) & 0xFFFFFF; }
+    static uint64_t end_of(uint64_t state) { return state & 0xFFFFFF; }
+
+    uint64_t read_state(int target) {
+        uint64_t unused = 0, state;
+        MPI_Fetch_and_op(&unused, &state, MPI_UINT64_T, target, 0, MPI_NO_OP, win);
+        MPI_Win_flush(target, win);
+        return state;
+    }
+    bool swap_state(int target, uint64_t expected, uint64_t desired) {
+        uint64_t old;
+        MPI_Compare_and_swap(&desired, &expected, &old, MPI_UINT64_T, target, 0, win);
+        MPI_Win_flush(target, win);
+        return old == expected;
+    }
+
+    MPI_Win win;
+    uint64_t* base;
+    int rank;
+    uint64_t generation;
+    std::vector<int64_t> offered; // Copy of the entries of the current offer
+};
+
+template <class GridT, class Cells>
+void solveUsingWorkStealingDFS(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end) {
+    int rank, commSize;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &commSize);
+    if (start == end) {
+        return;
+    }
+    int threads = omp_get_max_threads();
+    std::vector<WorkDeque> deques(threads);
+    OfferWindow window(comm);
+
+    maze.set_visited_solve(start);
+    if (rank == 0) {
+        deques[0].push(ENTRY(start, 0));
+    }
+
+    // Shared by the threads (atomics): threads holding or looking for work, whether this rank found the end, and
+    // whether the ranks agreed to stop
+    int busy = threads, found = 0, stop = 0;
+
+    // Master thread only
+    std::vector<std::pair<node_t, int>> remote_roots; // Cells stolen from another rank, with that rank
+    std::vector<int64_t> taken, offer;
+    int next_victim = 0;
+    bool stole = false, all_idle = false;
+    int found_rank = commSize;
+    int state[2], global[2];
+    MPI_Request request = MPI_REQUEST_NULL;
+
+    // Visit node with the given parent direction, false if it already was. Only the threads of a rank need atomics
+    auto claim = [&](node_t node, int dir) {
+        if (threads > 1) {
+            return maze.claim_solve(node, dir);
+        }
+        if (maze.is_visited_solve(node)) {
+            return false;
+        }
+        maze.set_visited_solve(node);
+        maze.set_parent_dir(node, dir);
+        return true;
+    };
+
+    // Push the unvisited neighbours of the cell of entry, last one first so that the first is taken first and a single
+    // thread visits the cells in the order of solveUsingDFS
+    auto expand = [&](int64_t entry, WorkDeque& own) {
+        int64_t children[4];
+        int count = 0;
+        grid.for_each_neighbour(ENTRY_NODE(entry), [&](node_t child, int dir) {
+            if (maze.is_c(child) && claim(child, OPPOSITE_DIR(dir))) {
+                children[count++] = ENTRY(child, OPPOSITE_DIR(dir));
+                if (child == end) {
+                    __atomic_store_n(&found, 1, __ATOMIC_RELAXED);
+                }
+            }
+            return false;
+        });
+        while (count > 0) {
+            own.push(children[--count]);
+        }
+    };
+
+    // An idle thread steals the oldest entry of the other threads of the rank, in turn
+    auto steal_local = [&](int id, int64_t& entry) {
+        for (int k = 1; k < threads; k++) {
+            if (deques[(id + k) % threads].steal(entry)) return true;
+        }
+        return false;
+    };
+
+    // Idle master: take back the rank's own offer, or steal from the next rank; pushes what it got to own
+    auto refill = [&](WorkDeque& own) {
+        taken.clear();
+        window.reclaim(taken);
+        if (!taken.empty()) {
+            for (int64_t entry : taken) own.push(entry);
+            return true;
+        }
+        if (commSize == 1) {
+            return false;
+        }
+        int victim = (rank + 1 + next_victim) % commSize;
+        next_victim = (next_victim + 1) % (commSize - 1);
+        if (!window.steal(victim, taken)) {
+            return false;
+        }
+        stole = true;
+        bool pushed = false;
+        for (int64_t entry : taken) {
+            node_t node = ENTRY_NODE(entry);
+            int dir = ENTRY_DIR(entry);
+            claim(grid.step(node, dir), dir); // The parent was expanded by the victim
+            if (!claim(node, dir)) continue; // Already reached here through a loop
+            remote_roots.push_back({node, victim});
+            own.push(entry);
+            pushed = true;
+            if (node == end) __atomic_store_n(&found, 1, __ATOMIC_RELAXED);
+        }
+        return pushed;
+    };
+
+    // Master: offer entries if nothing is on offer, then the termination reduction; true once every rank has to stop
+    auto poll = [&]() {
+        bool found_here = __atomic_load_n(&found, __ATOMIC_RELAXED);
+        if (commSize > 1 && !found_here && window.empty()) {
+            offer.clear();
+            int64_t entry;
+            for (int t = 0; t < threads; t++) {
+                while ((int)offer.size() < WSDFS_SHARE && deques[t].size() > 1 && deques[t].steal(entry)) {
+                    offer.push_back(entry);
+                }
+            }
+            if (!offer.empty()) window.offer(offer);
+        }
+        if (request != MPI_REQUEST_NULL) {
+            int complete;
+            MPI_Test(&request, &complete, MPI_STATUS_IGNORE);
+            if (!complete) {
+                return false;
+            }
+            if (global[0] < commSize) {
+                found_rank = global[0];
+                return true;
+            }
+            if (global[1] == 1 && all_idle) {
+                return true;
+            }
+            all_idle = global[1] == 1;
+        }
+        bool idle = __atomic_load_n(&busy, __ATOMIC_SEQ_CST) == 0 && window.empty();
+        state[0] = found_here ? rank : commSize;
+        state[1] = idle && !stole;
+        stole = false;
+        MPI_Iallreduce(state, global, 2, MPI_INT, MPI_MIN, comm, &request);
+        return false;
+    };
+
+    #pragma omp parallel
+    {
+        int id = omp_get_thread_num();
+        WorkDeque& own = deques[id];
+        bool active = true; // Counted in busy
+        long since_poll = WSDFS_POLL_INTERVAL;
+        while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+            bool searching = !__atomic_load_n(&found, __ATOMIC_RELAXED);
+            int64_t entry;
+            bool got = searching && own.take(entry);
+            if (!got && searching) {
+                // The deque is empty: leave busy, and count in again while stealing so that busy == 0 means no thread
+                // of the rank holds a cell
+                if (active) {
+                    active = false;
+                    __atomic_fetch_sub(&busy, 1, __ATOMIC_SEQ_CST);
+                }
+                __atomic_fetch_add(&busy, 1, __ATOMIC_SEQ_CST);
+                got = steal_local(id, entry) || (id == 0 && refill(own) && own.take(entry));
+                if (got) {
+                    active = true;
+                } else {
+                    __atomic_fetch_sub(&busy, 1, __ATOMIC_SEQ_CST);
+                }
+            }
+            if (got) {
+                expand(entry, own);
+            }
+            if (id == 0 && (!got || ++since_poll >= WSDFS_POLL_INTERVAL)) {
+                since_poll = 0;
+                if (poll()) {
+                    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+                }
+            }
+            if (!got) {
+                sched_yield();
+            }
+        }
+    }
+    window.free();
+
+    if (found_rank == commSize) {
+        return; // end is not reachable
+    }
+
+    // Walk the path back through the ranks: each one marks its piece up to the start or a cell it stole, the victim
+    // goes on from that cell (it has the cell's parent)
+    std::sort(remote_roots.begin(), remote_roots.end());
+    auto victim_of = [&](node_t node) {
+        auto it = std::lower_bound(remote_roots.begin(), remote_roots.end(), std::make_pair(node, -1));
+        return it != remote_roots.end() && it->first == node ? it->second : -1;
+    };
+    std::vector<node_t> path;
+    node_t hop[2] = {end, found_rank}; // Cell to walk from, rank walking
+    while (true) {
+        int walker = (int)hop[1];
+        if (rank == walker) {
+            node_t stolen = walk_parents(grid, maze, hop[0], start, [&](node_t node) { return victim_of(node) == -1; },
+                                         [&](node_t node) { path.push_back(node); });
+            hop[0] = stolen;
+            hop[1] = stolen == start ? -1 : victim_of(stolen);
+        }
+        MPI_Bcast(hop, 2, MPI_NODE_T, walker, comm);
+        if (hop[1] == -1) {
+            break;
+        }
+    }
+    share_path(maze, path, comm);
+}
+
+#define INSTANTIATE_WSDFS(GridT, Cells) template void solveUsingWorkStealingDFS<GridT, Cells>(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end);
+FOR_EACH_MAZE_TYPE(INSTANTIATE_WSDFS)
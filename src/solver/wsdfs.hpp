@@ -0,0 +1,16 @@
+#include <mpi.h>
+#include "defs.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
+
+// Expansions of the master thread of a rank between two rounds of its MPI work (offering cells to the other ranks,
+// termination checks)
+#define WSDFS_POLL_INTERVAL 1024
+
+// Largest number of cells a rank offers to the other ranks at once, a thief takes half of them
+#define WSDFS_SHARE 8
+
+// Path from start to end with a DFS whose ranks and threads steal work from each other (see wsdfs.cpp)
+// The threads of a rank (-t) share its cells, the path is marked P everywhere
+template <class GridT, class Cells>
+void solveUsingWorkStealingDFS(const GridT& grid, Cells& maze, MPI_Comm comm, node_t start, node_t end);
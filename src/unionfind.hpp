@@ -0,0 +1,83 @@
+#ifndef UNIONFIND_H
+#define UNIONFIND_H
+
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include "defs.hpp"
+
+// Union-find over n elements in one flat array of int32: the parent of an element, or -(size of its set) for a root
+// - Union by size and path halving, 4 bytes per element and no other allocation
+class FlatUnionFind {
+public:
+    explicit FlatUnionFind(node_t n) : parent(n, -1) {}
+
+    int32_t find(int32_t x) {
+        while (parent[x] >= 0) {
+            int32_t up = parent[x];
+            if (parent[up] >= 0) parent[x] = parent[up];
+            x = up;
+        }
+        return x;
+    }
+
+    // Merge the sets of x and y, returns false if they were already the same set
+    bool unite(int32_t x, int32_t y) {
+        x = find(x);
+        y = find(y);
+        if (x == y) return false;
+        if (parent[x] > parent[y]) std::swap(x, y);
+        parent[x] += parent[y];
+        parent[y] = x;
+        return true;
+    }
+
+private:
+    std::vector<int32_t> parent;
+};
+
+// Union-find shared by threads, lock-free: every write is a compare-and-swap on one parent entry (Anderson & Woll)
+// - parent[x] == x for a root. A root is only ever linked below a root of higher priority, priority(x) being a
+//   bijective hash of x (union by random index), so the parent pointers can't form a cycle whatever the interleaving
+//   and the trees stay O(log n) deep in expectation even though grid node ids are not random
+// - find() halves the path it walks with a CAS per step; losing that race is harmless (someone else shortened it)
+// - unite() succeeds for exactly one of the threads joining the same two sets, so the edges it accepts form a forest
+class ConcurrentUnionFind {
+public:
+    explicit ConcurrentUnionFind(node_t n) : parent(n) {
+        #pragma omp parallel for schedule(static)
+        for (node_t x = 0; x < n; x++) parent[x] = (int32_t)x;
+    }
+
+    int32_t find(int32_t x) {
+        while (true) {
+            int32_t up = __atomic_load_n(&parent[x], __ATOMIC_RELAXED);
+            if (up == x) return x;
+            int32_t upper = __atomic_load_n(&parent[up], __ATOMIC_RELAXED);
+            if (upper == up) return up;
+            __atomic_compare_exchange_n(&parent[x], &up, upper, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            x = upper;
+        }
+    }
+
+    // Merge the sets of x and y, returns false if they were already the same set
+    bool unite(int32_t x, int32_t y) {
+        while (true) {
+            x = find(x);
+            y = find(y);
+            if (x == y) return false;
+            if (priority(x) > priority(y)) std::swap(x, y);
+            int32_t expected = x;
+            if (__atomic_compare_exchange_n(&parent[x], &expected, y, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) return true;
+            // x was linked by another thread in the meantime, retry from the new roots
+        }
+    }
+
+private:
+    static uint32_t priority(int32_t x) { return (uint32_t)x * 0x9E3779B1u; }
+
+    std::vector<int32_t> parent;
+};
+
+#endif // UNIONFIND_H
@@ -0,0 +1,108 @@
+#ifndef WORKDEQUE_H
+#define WORKDEQUE_H
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+// Initial number of entries of a WorkDeque (it doubles when full)
+#define WORK_DEQUE_CAPACITY 1024
+
+// Work-stealing deque of one thread, lock-free (Chase & Lev, "Dynamic circular work-stealing deque", with the memory
+// orderings of Le et al., "Correct and efficient work-stealing for weak memory models")
+// - The owner pushes and takes at the bottom (LIFO), any thread steals at the top, i.e. the oldest entry. For a DFS
+//   that is the cell closest to the root, so a thief takes the largest piece of work there is
+// - The owner only races with thieves for the last entry, a steal is one compare-and-swap on top
+// - The ring doubles when full; the old rings are kept until the deque is destroyed since a thief may still read one
+class WorkDeque {
+public:
+    WorkDeque() : top(0), bottom(0) {
+        rings.emplace_back(new Ring(WORK_DEQUE_CAPACITY));
+        ring = rings.back().get();
+    }
+    WorkDeque(const WorkDeque&) = delete;
+
+    // Owner only
+    void push(int64_t item) {
+        int64_t b = __atomic_load_n(&bottom, __ATOMIC_RELAXED);
+        int64_t t = __atomic_load_n(&top, __ATOMIC_ACQUIRE);
+        Ring* r = __atomic_load_n(&ring, __ATOMIC_RELAXED);
+        if (b - t > r->mask) {
+            r = grow(r, t, b);
+        }
+        r->put(b, item);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store_n(&bottom, b + 1, __ATOMIC_RELAXED);
+    }
+
+    // Owner only: the newest entry, false if the deque is empty
+    bool take(int64_t& item) {
+        int64_t b = __atomic_load_n(&bottom, __ATOMIC_RELAXED) - 1;
+        Ring* r = __atomic_load_n(&ring, __ATOMIC_RELAXED);
+        // The store of bottom and the load of top must not be reordered (a thief does the opposite), a seq_cst store
+        // is one xchg on x86 where a fence would be an mfence on top of the store
+        __atomic_store_n(&bottom, b, __ATOMIC_SEQ_CST);
+        int64_t t = __atomic_load_n(&top, __ATOMIC_SEQ_CST);
+        if (t > b) {
+            __atomic_store_n(&bottom, b + 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        item = r->get(b);
+        if (t == b) {
+            // Last entry, a thief may be stealing it: whoever moves top gets it
+            bool won = __atomic_compare_exchange_n(&top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+            __atomic_store_n(&bottom, b + 1, __ATOMIC_RELAXED);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread: the oldest entry, false if the deque is empty or another thread got it first
+    bool steal(int64_t& item) {
+        int64_t t = __atomic_load_n(&top, __ATOMIC_ACQUIRE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        int64_t b = __atomic_load_n(&bottom, __ATOMIC_ACQUIRE);
+        if (t >= b) {
+            return false;
+        }
+        Ring* r = __atomic_load_n(&ring, __ATOMIC_ACQUIRE);
+        item = r->get(t);
+        return __atomic_compare_exchange_n(&top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    }
+
+    // Entries in the deque, only a hint when other threads use it
+    int64_t size() const {
+        int64_t b = __atomic_load_n(&bottom, __ATOMIC_RELAXED);
+        int64_t t = __atomic_load_n(&top, __ATOMIC_RELAXED);
+        return b > t ? b - t : 0;
+    }
+
+private:
+    // Circular array indexed by the (ever growing) top / bottom positions
+    struct Ring {
+        int64_t mask;
+        std::unique_ptr<int64_t[]> items;
+
+        explicit Ring(int64_t capacity) : mask(capacity - 1), items(new int64_t[capacity]) {}
+        int64_t get(int64_t i) const { return __atomic_load_n(&items[i & mask], __ATOMIC_RELAXED); }
+        void put(int64_t i, int64_t item) { __atomic_store_n(&items[i & mask], item, __ATOMIC_RELAXED); }
+    };
+
+    Ring* grow(Ring* old, int64_t t, int64_t b) {
+        rings.emplace_back(new Ring(2 * (old->mask + 1)));
+        Ring* r = rings.back().get();
+        for (int64_t i = t; i < b; i++) {
+            r->put(i, old->get(i));
+        }
+        __atomic_store_n(&ring, r, __ATOMIC_RELEASE);
+        return r;
+    }
+
+    // Thieves hammer top and the owner bottom, keep them (and the deques of other threads) on separate cache lines
+    alignas(64) int64_t top;
+    alignas(64) int64_t bottom;
+    Ring* ring;
+    std::vector<std::unique_ptr<Ring>> rings; // The current one last, owner only
+};
+
+#endif // WORKDEQUE_H